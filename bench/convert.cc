@@ -0,0 +1,122 @@
+//
+// Compares the sargs number conversions with the strto* functions they replaced
+//
+#include "sargs.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+
+using namespace sargs;
+using namespace std;
+
+namespace {
+
+const size_t kIterations = 200;
+
+vector<string> MakeIntegers() {
+  vector<string> values;
+  uint64_t value = 1;
+  for (size_t i = 0; i < 10000; ++i) {
+    value = value * 6364136223846793005ull + 1442695040888963407ull;
+    ostringstream stream;
+    if (i % 4 == 0)
+      stream << "0x" << hex << (value >> (i % 48));
+    else if (i % 2 == 0)
+      stream << "-" << (value >> (i % 40 + 4));
+    else
+      stream << (value >> (i % 40 + 1));
+    values.push_back(stream.str());
+  }
+  return values;
+}
+
+vector<string> MakeFloats() {
+  vector<string> values;
+  uint64_t value = 1;
+  for (size_t i = 0; i < 10000; ++i) {
+    value = value * 6364136223846793005ull + 1442695040888963407ull;
+    ostringstream stream;
+    if (i % 3 == 0)
+      stream << (value >> 44) << "." << (value & 0xFFF);
+    else if (i % 3 == 1)
+      stream << setprecision(17) << static_cast<double>(value >> 11) / 9007199254740992.0;
+    else
+      stream << (value >> 54) << "e" << static_cast<int>(value % 40) - 20;
+    values.push_back(stream.str());
+  }
+  return values;
+}
+
+template <typename Function>
+void Report(const char* name, const vector<string>& values, Function function) {
+  double checksum = 0.0;
+  const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (size_t iteration = 0; iteration < kIterations; ++iteration) {
+    for (const string& value : values)
+      checksum += function(value);
+  }
+  const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+  const double per_value = elapsed.count() / static_cast<double>(kIterations * values.size());
+  cout << left << setw(24) << name << right << setw(12) << fixed << setprecision(2) << per_value
+       << " ns/call  (checksum " << setprecision(0) << checksum << ")" << endl;
+}
+
+}  // namespace
+
+int main(int, char* []) {
+  const vector<string> integers = MakeIntegers();
+  const vector<string> floats = MakeFloats();
+
+  Report("strtoll", integers, [](const string& text) {
+    errno = 0;
+    const long long value = strtoll(text.c_str(), nullptr, 0);
+    return (errno == ERANGE) ? 0.0 : static_cast<double>(value);
+  });
+  Report("ConvertNumber<int64_t>", integers, [](const string& text) {
+    int64_t value = 0;
+    return ConvertNumber(text.data(), text.size(), value) ? static_cast<double>(value) : 0.0;
+  });
+  Report("strtod", floats, [](const string& text) {
+    errno = 0;
+    const double value = strtod(text.c_str(), nullptr);
+    return (errno == ERANGE) ? 0.0 : value;
+  });
+  Report("ConvertNumber<double>", floats, [](const string& text) {
+    double value = 0.0;
+    return ConvertNumber(text.data(), text.size(), value) ? value : 0.0;
+  });
+  Report("strtof", floats, [](const string& text) {
+    errno = 0;
+    const float value = strtof(text.c_str(), nullptr);
+    return (errno == ERANGE) ? 0.0 : static_cast<double>(value);
+  });
+  Report("ConvertNumber<float>", floats, [](const string& text) {
+    float value = 0.0f;
+    return ConvertNumber(text.data(), text.size(), value) ? static_cast<double>(value) : 0.0;
+  });
+
+  // One 10k element list, as given by --weights=...
+  string list;
+  for (const string& value : floats)
+    list += (list.empty() ? "" : ",") + value;
+  const vector<string> lists(1, list);
+  Report("split + strtof (list)", lists, [](const string& text) {
+    double sum = 0.0;
+    stringstream stream(text);
+    string value;
+    while (getline(stream, value, ','))
+      sum += strtof(value.c_str(), nullptr);
+    return sum;
+  });
+  Report("ConvertList<float>", lists, [](const string& text) {
+    static vector<float> values;
+    size_t offset = 0;
+    double sum = 0.0;
+    if (ConvertList(text.data(), text.size(), ',', values, offset)) {
+      for (const float value : values)
+        sum += value;
+    }
+    return sum;
+  });
+  return 0;
+}
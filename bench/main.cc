@@ -0,0 +1,266 @@
+//
+// Parser benchmarks. Results are written as CSV or JSON so runs can be compared over time.
+//
+#include "sargs.h"
+#include <chrono>
+#include <functional>
+
+using namespace sargs;
+using namespace std;
+
+namespace {
+
+struct Result {
+  string name;
+  size_t flags;
+  size_t tokens;
+  string style;
+  size_t iterations;
+  double ns_per_iteration;
+};
+
+// Owns the strings behind an argv array
+class ArgvBuilder {
+ public:
+  ArgvBuilder() {
+    this->Add("sargs_bench");
+  }
+
+  void Add(const string& arg) {
+    _storage.push_back(arg);
+  }
+
+  int argc() const {
+    return static_cast<int>(_storage.size());
+  }
+
+  char** argv() {
+    _argv.clear();
+    for (string& arg : _storage)
+      _argv.push_back(&arg.front());
+    return _argv.data();
+  }
+
+ private:
+  vector<string> _storage;
+  vector<char*> _argv;
+};
+
+string FlagName(const size_t index) {
+  return "--flag" + to_string(index);
+}
+
+string AliasName(const size_t index) {
+  return "-f" + to_string(index);
+}
+
+// Runs function until at least min_time has passed and returns the average time of one run
+double Measure(const function<void()>& function, const chrono::milliseconds min_time, size_t& iterations) {
+  function();
+  iterations = 0;
+  const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  chrono::steady_clock::duration elapsed;
+  do {
+    function();
+    ++iterations;
+    elapsed = chrono::steady_clock::now() - start;
+  } while (elapsed < min_time);
+  return chrono::duration<double, nano>(elapsed).count() / static_cast<double>(iterations);
+}
+
+class Runner {
+ public:
+  Runner(const size_t max_tokens, const chrono::milliseconds min_time) :
+    _max_tokens(max_tokens), _min_time(min_time) {}
+
+  // Initialize() on a new Args for registries of 10 to 10k flags, each given once
+  void Registry() {
+    const char* styles[] = { "equals", "space", "alias_equals", "alias_space" };
+    for (size_t flags = 10; flags <= 10000; flags *= 10) {
+      for (const char* style : styles) {
+        const bool alias = (style[0] == 'a');
+        const bool equals = (string(style).find("equals") != string::npos);
+        ArgvBuilder args;
+        for (size_t i = 0; i < flags; ++i) {
+          const string name = alias ? AliasName(i) : FlagName(i);
+          if (equals) {
+            args.Add(name + "=" + to_string(i));
+          } else {
+            args.Add(name);
+            args.Add(to_string(i));
+          }
+        }
+        if (static_cast<size_t>(args.argc()) > _max_tokens)
+          continue;
+
+        char** argv = args.argv();
+        this->Run("initialize_registry", flags, args.argc() - 1, style, [&]() {
+          Args parser;
+          for (size_t i = 0; i < flags; ++i)
+            parser.AddOptionalFlagValue(FlagName(i), AliasName(i), "Benchmark flag");
+          parser.Initialize(args.argc(), argv);
+        });
+
+        Args reused;
+        for (size_t i = 0; i < flags; ++i)
+          reused.AddOptionalFlagValue(FlagName(i), AliasName(i), "Benchmark flag");
+        this->Run("reparse_registry", flags, args.argc() - 1, style, [&]() {
+          reused.Reset();
+          reused.Initialize(args.argc(), argv);
+        });
+      }
+    }
+  }
+
+  // Reparsing argv of 10 to 1M tokens. A few flags are set and the rest are non-flags. The parallel style
+  // copies like the default one, on a thread per core once there are enough tokens.
+  void ArgvLength() {
+    const size_t flags = 100;
+    const char* styles[] = { "copy", "views", "parallel" };
+    for (size_t tokens = 10; tokens <= _max_tokens; tokens *= 10) {
+      for (const char* style : styles) {
+        ArgvBuilder args;
+        const size_t flag_tokens = std::min<size_t>(10, tokens / 2);
+        for (size_t i = 0; i < flag_tokens; ++i)
+          args.Add(FlagName(i) + "=" + to_string(i));
+        for (size_t i = flag_tokens; i < tokens; ++i)
+          args.Add("path/to/input/file" + to_string(i) + ".dat");
+
+        Args parser;
+        for (size_t i = 0; i < flags; ++i)
+          parser.AddOptionalFlagValue(FlagName(i), AliasName(i), "Benchmark flag");
+        parser.RequireNonFlags(static_cast<int>(tokens - flag_tokens));
+        if (style == string("views"))
+          parser.EnableArgvViews();
+        else if (style == string("parallel"))
+          parser.EnableParallelParse();
+        char** argv = args.argv();
+        this->Run("reparse_argv", flags, tokens, style, [&]() {
+          parser.Initialize(args.argc(), argv);
+        });
+      }
+    }
+  }
+
+  // The getters on a parsed registry of 1000 flags with 10k non-flags. Times are per call.
+  void Getters() {
+    const size_t flags = 1000;
+    const size_t nonflags = std::min<size_t>(10000, _max_tokens);
+    ArgvBuilder args;
+    for (size_t i = 0; i < flags; ++i)
+      args.Add(FlagName(i) + "=" + to_string(i));
+    for (size_t i = 0; i < nonflags; ++i)
+      args.Add("file" + to_string(i));
+
+    Args parser;
+    vector<FlagId> ids;
+    vector<string> names;
+    for (size_t i = 0; i < flags; ++i) {
+      ids.push_back(parser.AddOptionalFlagValue(FlagName(i), AliasName(i), "Benchmark flag"));
+      names.push_back(FlagName(i));
+    }
+    parser.RequireNonFlags(static_cast<int>(nonflags));
+    parser.Initialize(args.argc(), args.argv());
+
+    int64_t sink = 0;
+    this->Run("get_as_int64", flags, 1, "name", [&]() {
+      for (const string& name : names)
+        sink += parser.GetAsInt64(name);
+    }, flags);
+    this->Run("get_as_string", flags, 1, "name", [&]() {
+      for (const string& name : names)
+        sink += static_cast<int64_t>(parser.GetAsString(name).size());
+    }, flags);
+    this->Run("has", flags, 1, "name", [&]() {
+      for (const string& name : names)
+        sink += parser.Has(name) ? 1 : 0;
+    }, flags);
+    this->Run("has", flags, 1, "id", [&]() {
+      for (const FlagId id : ids)
+        sink += parser.Has(id) ? 1 : 0;
+    }, flags);
+    this->Run("get_nonflags", flags, nonflags, "copy", [&]() {
+      sink += static_cast<int64_t>(parser.GetNonFlags().size());
+    });
+    this->Run("get_nonflag_views", flags, nonflags, "views", [&]() {
+      sink += static_cast<int64_t>(parser.GetNonFlagViews().size());
+    });
+    if (sink == 0)
+      cerr << "Unexpected getter results" << endl;
+  }
+
+  void WriteCsv(ostream& output) const {
+    output << "benchmark,flags,tokens,style,iterations,ns_per_iteration,ns_per_token\n";
+    for (const Result& result : _results) {
+      output << result.name << ',' << result.flags << ',' << result.tokens << ',' << result.style << ','
+             << result.iterations << ',' << fixed << setprecision(1) << result.ns_per_iteration << ','
+             << setprecision(2) << result.ns_per_iteration / static_cast<double>(result.tokens) << '\n';
+    }
+  }
+
+  void WriteJson(ostream& output) const {
+    output << "[\n";
+    for (size_t i = 0; i < _results.size(); ++i) {
+      const Result& result = _results[i];
+      output << "  {\"benchmark\": \"" << result.name << "\", \"flags\": " << result.flags
+             << ", \"tokens\": " << result.tokens << ", \"style\": \"" << result.style
+             << "\", \"iterations\": " << result.iterations << ", \"ns_per_iteration\": " << fixed
+             << setprecision(1) << result.ns_per_iteration << ", \"ns_per_token\": " << setprecision(2)
+             << result.ns_per_iteration / static_cast<double>(result.tokens) << "}"
+             << (i + 1 < _results.size() ? ",\n" : "\n");
+    }
+    output << "]\n";
+  }
+
+ private:
+  size_t _max_tokens;
+  chrono::milliseconds _min_time;
+  vector<Result> _results;
+
+  // operations is the number of calls made by one run of function, for getters that loop over flags
+  void Run(const string& name, const size_t flags, const size_t tokens, const string& style,
+           const function<void()>& function, const size_t operations = 1) {
+    Result result;
+    result.name = name;
+    result.flags = flags;
+    result.tokens = tokens;
+    result.style = style;
+    result.ns_per_iteration = Measure(function, _min_time, result.iterations) / static_cast<double>(operations);
+    result.iterations *= operations;
+    _results.push_back(result);
+    cerr << name << ' ' << flags << ' ' << tokens << ' ' << style << ": " << fixed << setprecision(1)
+         << result.ns_per_iteration << " ns" << endl;
+  }
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Args args;
+  args.AddOptionalFlagValue("--format", "-f", "Output format, csv or json", "csv");
+  args.AddOptionalFlagValue("--max-tokens", "-t", "Largest argv to benchmark", "1000000");
+  args.AddOptionalFlagValue("--min-time", "-m", "Minimum time to run each benchmark in milliseconds", "200");
+  args.AddOptionalFlagValue("--only", "-o", "Run one group: registry, argv or getters");
+  args.Initialize(argc, argv);
+
+  const string format = args.GetAsString("--format");
+  if (format != "csv" && format != "json") {
+    cerr << "Unknown format " << format << endl;
+    return 1;
+  }
+
+  Runner runner(args.GetAsUInt64("--max-tokens"), chrono::milliseconds(args.GetAsUInt32("--min-time")));
+  const string only = args.GetAsString("--only");
+  if (only.empty() || only == "registry")
+    runner.Registry();
+  if (only.empty() || only == "argv")
+    runner.ArgvLength();
+  if (only.empty() || only == "getters")
+    runner.Getters();
+
+  if (format == "json")
+    runner.WriteJson(cout);
+  else
+    runner.WriteCsv(cout);
+  return 0;
+}
@@ -0,0 +1,205 @@
+//
+// Launches sargs_startup_* programs over and over and reports how long they take from exec to the end of
+// SARGS_INITIALIZE(), their peak RSS, the heap allocations made by then and how much sargs adds to the
+// size of the binary. POSIX only.
+//
+#include "sargs.h"
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdlib>
+
+using namespace sargs;
+using namespace std;
+
+namespace {
+
+struct Launch {
+  long long start_ns;
+  long long main_ns;
+  long long end_ns;
+  unsigned long long allocations;
+  long max_rss_kb;
+};
+
+struct Summary {
+  string binary;
+  int flags;
+  size_t tokens;
+  double exec_p50_us;
+  double exec_p99_us;
+  double total_p50_us;
+  double total_p99_us;
+  long max_rss_kb;
+  unsigned long long allocations;
+  long long size_bytes;
+  long long size_over_baseline;
+};
+
+long long Now() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<long long>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+long long FileSize(const string& path) {
+  struct stat info;
+  return (stat(path.c_str(), &info) == 0) ? static_cast<long long>(info.st_size) : -1;
+}
+
+// Runs binary with argv and env and returns what it printed, or false if it failed
+bool Run(const string& binary, vector<char*>& argv, vector<char*>& env, string& output, Launch& launch) {
+  int pipe_fds[2];
+  if (pipe(pipe_fds) != 0)
+    return false;
+
+  launch.start_ns = Now();
+  const pid_t pid = fork();
+  if (pid == 0) {
+    dup2(pipe_fds[1], STDOUT_FILENO);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    execve(binary.c_str(), argv.data(), env.data());
+    _exit(127);
+  }
+  close(pipe_fds[1]);
+  if (pid < 0) {
+    close(pipe_fds[0]);
+    return false;
+  }
+
+  output.clear();
+  char buffer[256];
+  ssize_t count = 0;
+  while ((count = read(pipe_fds[0], buffer, sizeof(buffer))) > 0)
+    output.append(buffer, static_cast<size_t>(count));
+  close(pipe_fds[0]);
+
+  int status = 0;
+  rusage usage;
+  if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    return false;
+  launch.max_rss_kb = usage.ru_maxrss;
+  return true;
+}
+
+double Percentile(vector<long long> values, const double percentile) {
+  sort(values.begin(), values.end());
+  const size_t index = static_cast<size_t>(percentile * static_cast<double>(values.size() - 1) + 0.5);
+  return static_cast<double>(values[index]) / 1000.0;
+}
+
+bool Measure(const string& binary, const size_t runs, const size_t nonflags, Summary& summary) {
+  vector<char*> no_args = { const_cast<char*>(binary.c_str()), nullptr };
+  string describe_env = "SARGS_STARTUP_DESCRIBE=1";
+  vector<char*> env = { &describe_env.front(), nullptr };
+  string output;
+  Launch launch;
+  if (!Run(binary, no_args, env, output, launch))
+    return false;
+  summary.binary = binary;
+  summary.flags = atoi(output.c_str());
+
+  // Give every flag a value, named as startup_target.cc names them, followed by the non-flags
+  vector<string> args = { binary };
+  int digits = 0;
+  for (int count = summary.flags; count > 1; count /= 10)
+    ++digits;
+  for (int i = 0; i < summary.flags; ++i) {
+    string number = to_string(i);
+    number.insert(0, static_cast<size_t>(digits) - number.size(), '0');
+    args.push_back("--flag" + number + "=" + to_string(i));
+  }
+  for (size_t i = 0; i < nonflags; ++i)
+    args.push_back("path/to/input/file" + to_string(i) + ".dat");
+  vector<char*> argv;
+  for (string& arg : args)
+    argv.push_back(&arg.front());
+  argv.push_back(nullptr);
+  summary.tokens = args.size() - 1;
+
+  string nonflags_env = "SARGS_STARTUP_NONFLAGS=" + to_string(nonflags);
+  env[0] = &nonflags_env.front();
+
+  vector<long long> exec_ns;
+  vector<long long> total_ns;
+  summary.max_rss_kb = 0;
+  summary.allocations = 0;
+  for (size_t run = 0; run < runs; ++run) {
+    if (!Run(binary, argv, env, output, launch))
+      return false;
+    if (sscanf(output.c_str(), "%lld %lld %llu", &launch.main_ns, &launch.end_ns, &launch.allocations) != 3)
+      return false;
+    exec_ns.push_back(launch.main_ns - launch.start_ns);
+    total_ns.push_back(launch.end_ns - launch.start_ns);
+    summary.max_rss_kb = max(summary.max_rss_kb, launch.max_rss_kb);
+    summary.allocations = launch.allocations;
+  }
+
+  summary.exec_p50_us = Percentile(exec_ns, 0.5);
+  summary.exec_p99_us = Percentile(exec_ns, 0.99);
+  summary.total_p50_us = Percentile(total_ns, 0.5);
+  summary.total_p99_us = Percentile(total_ns, 0.99);
+  summary.size_bytes = FileSize(binary);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  vector<string> binaries;
+  Args args;
+  args.AddOptionalFlagValue("--runs", "-r", "Launches of each program", "200");
+  args.AddOptionalFlagValue("--nonflags", "-n", "Non-flags passed to each program", "10000");
+  args.AddOptionalFlagValue("--baseline", "-b", "Program built without sargs to compare against");
+  args.AddOptionalFlagValue("--format", "-f", "Output format, csv or json", "csv");
+  args.SetNonFlagHandler([&](const StringView& binary) { binaries.push_back(binary); });
+  args.Initialize(argc, argv);
+
+  const size_t runs = args.GetAsUInt64("--runs");
+  const size_t nonflags = args.GetAsUInt64("--nonflags");
+  const string format = args.GetAsString("--format");
+  const string baseline = args.GetAsString("--baseline");
+  if (!baseline.empty())
+    binaries.insert(binaries.begin(), baseline);
+
+  vector<Summary> summaries;
+  for (const string& binary : binaries) {
+    Summary summary;
+    if (runs == 0 || !Measure(binary, runs, nonflags, summary)) {
+      cerr << "Could not run " << binary << endl;
+      return 1;
+    }
+    summary.size_over_baseline = baseline.empty() ? 0 : summary.size_bytes - FileSize(baseline);
+    summaries.push_back(summary);
+  }
+
+  if (format == "json")
+    cout << "[\n";
+  else
+    cout << "binary,flags,tokens,exec_p50_us,exec_p99_us,total_p50_us,total_p99_us,max_rss_kb,allocations,"
+            "size_bytes,size_over_baseline\n";
+  for (size_t i = 0; i < summaries.size(); ++i) {
+    const Summary& summary = summaries[i];
+    cout << fixed << setprecision(1);
+    if (format == "json") {
+      cout << "  {\"binary\": \"" << summary.binary << "\", \"flags\": " << summary.flags
+           << ", \"tokens\": " << summary.tokens << ", \"exec_p50_us\": " << summary.exec_p50_us
+           << ", \"exec_p99_us\": " << summary.exec_p99_us << ", \"total_p50_us\": " << summary.total_p50_us
+           << ", \"total_p99_us\": " << summary.total_p99_us << ", \"max_rss_kb\": " << summary.max_rss_kb
+           << ", \"allocations\": " << summary.allocations << ", \"size_bytes\": " << summary.size_bytes
+           << ", \"size_over_baseline\": " << summary.size_over_baseline << "}"
+           << (i + 1 < summaries.size() ? ",\n" : "\n");
+    } else {
+      cout << summary.binary << ',' << summary.flags << ',' << summary.tokens << ',' << summary.exec_p50_us << ','
+           << summary.exec_p99_us << ',' << summary.total_p50_us << ',' << summary.total_p99_us << ','
+           << summary.max_rss_kb << ',' << summary.allocations << ',' << summary.size_bytes << ','
+           << summary.size_over_baseline << '\n';
+    }
+  }
+  if (format == "json")
+    cout << "]\n";
+  return 0;
+}
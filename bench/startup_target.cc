@@ -0,0 +1,83 @@
+//
+// A program launched by sargs_startup. It registers STARTUP_FLAG_COUNT flags through the SARGS macros and
+// reports when main was entered, when SARGS_INITIALIZE() finished and how many heap allocations were made
+// by then. Built with STARTUP_BASELINE it does the same without sargs, to measure what sargs adds.
+//
+#include <time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if !defined(STARTUP_BASELINE)
+#include "sargs.h"
+#endif
+
+static unsigned long long g_allocations = 0;
+
+// Kept out of line so GCC does not pair the inlined free() with the operator new it sees at the call site
+#if defined(__GNUC__)
+#define STARTUP_NOINLINE __attribute__((noinline))
+#else
+#define STARTUP_NOINLINE
+#endif
+
+STARTUP_NOINLINE void* operator new(size_t size) {
+  ++g_allocations;
+  void* memory = std::malloc(size == 0 ? 1 : size);
+  if (memory == nullptr)
+    throw std::bad_alloc();
+  return memory;
+}
+
+STARTUP_NOINLINE void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+static long long Now() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<long long>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+#define STARTUP_FLAG(n) SARGS_OPTIONAL_FLAG_VALUE("--flag" #n, "-f" #n, "Startup benchmark flag " #n);
+
+#define STARTUP_FLAGS_10(p) \
+  STARTUP_FLAG(p##0) STARTUP_FLAG(p##1) STARTUP_FLAG(p##2) STARTUP_FLAG(p##3) STARTUP_FLAG(p##4) \
+  STARTUP_FLAG(p##5) STARTUP_FLAG(p##6) STARTUP_FLAG(p##7) STARTUP_FLAG(p##8) STARTUP_FLAG(p##9)
+
+#define STARTUP_FLAGS_100(p) \
+  STARTUP_FLAGS_10(p##0) STARTUP_FLAGS_10(p##1) STARTUP_FLAGS_10(p##2) STARTUP_FLAGS_10(p##3) \
+  STARTUP_FLAGS_10(p##4) STARTUP_FLAGS_10(p##5) STARTUP_FLAGS_10(p##6) STARTUP_FLAGS_10(p##7) \
+  STARTUP_FLAGS_10(p##8) STARTUP_FLAGS_10(p##9)
+
+#define STARTUP_FLAGS_1000(p) \
+  STARTUP_FLAGS_100(p##0) STARTUP_FLAGS_100(p##1) STARTUP_FLAGS_100(p##2) STARTUP_FLAGS_100(p##3) \
+  STARTUP_FLAGS_100(p##4) STARTUP_FLAGS_100(p##5) STARTUP_FLAGS_100(p##6) STARTUP_FLAGS_100(p##7) \
+  STARTUP_FLAGS_100(p##8) STARTUP_FLAGS_100(p##9)
+
+#define STARTUP_FLAGS_CONCAT(count) STARTUP_FLAGS_##count()
+#define STARTUP_FLAGS(count) STARTUP_FLAGS_CONCAT(count)
+
+int main(int argc, char* argv[]) {
+  const long long main_ns = Now();
+
+  // The harness asks once how many flags there are so it can give each of them a value
+  if (std::getenv("SARGS_STARTUP_DESCRIBE") != nullptr) {
+    std::printf("%d\n", STARTUP_FLAG_COUNT);
+    return 0;
+  }
+
+#if !defined(STARTUP_BASELINE)
+  const char* nonflags = std::getenv("SARGS_STARTUP_NONFLAGS");
+  SARGS_REQUIRE_NONFLAGS(nonflags == nullptr ? 0 : std::atoi(nonflags));
+  STARTUP_FLAGS(STARTUP_FLAG_COUNT)
+  SARGS_INITIALIZE(argc, argv);
+#else
+  (void)argc;
+  (void)argv;
+#endif
+
+  const long long end_ns = Now();
+  std::printf("%lld %lld %llu\n", main_ns, end_ns, g_allocations);
+  return 0;
+}
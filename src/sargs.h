@@ -4,20 +4,36 @@
 //
 #pragma once
 
-#include <cerrno>
 #include <cstdint>
 #include <cctype>
+#include <cstring>
+#include <functional>
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
 #include <limits>
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <cstdio>
+#endif
+
 namespace sargs {
 
 class SargsError : public std::runtime_error {
@@ -26,369 +42,3250 @@ class SargsError : public std::runtime_error {
   ~SargsError() = default;
 };
 
-struct Argument {
-  Argument(const std::string& _flag,
-           const std::string& _alias,
-           const std::string& _description,
-           const bool _value) :
-    flag(_flag), alias(_alias), description(_description), value(_value) {}
+// Why parsing failed. ParseResult::GetError() describes the failure in words.
+enum class ErrorCode {
+  kNone,
+  kUnknownArguments,   // Non-flags were given but none are expected
+  kNonFlagCount,       // The wrong number of non-flags was given
+  kMissingValue,       // A flag taking a value was the last argument
+  kMissingFlag,        // A required flag was not given
+  kMissingFlagValue,   // A flag taking a value was given an empty one
+  kResponseFileDepth,  // Response files named each other too deeply
+  kResponseFileRead,   // A response file could not be read
+  kBinaryFile,         // The file named by a binary flag could not be mapped
+  kTooManyFlags,       // More flags were registered than the fixed capacity build allows
+  kTooManyArguments,   // More arguments were given than the fixed capacity build allows
+  kOutOfSpace,         // Flag names and descriptions did not fit in the memory given to the schema
+};
 
-  Argument(const std::string& _flag,
-           const std::string& _alias,
-           const std::string& _description,
-           const bool _value,
-           const std::string& _fallback) :
-    flag(_flag), alias(_alias), description(_description), fallback(_fallback), value(_value) {}
+// Non-owning reference to characters held by argv or by Args. Views returned by Args stay valid until
+// the next call to Initialize() and, when argv views are enabled, for as long as argv is alive.
+class StringView {
+ public:
+  StringView() = default;
+  StringView(const char* data) : _data(data), _size(std::strlen(data)) {}
+  StringView(const char* data, const size_t size) : _data(data), _size(size) {}
+  StringView(const std::string& str) : _data(str.data()), _size(str.size()) {}
+
+  const char* data() const { return _data; }
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  const char* begin() const { return _data; }
+  const char* end() const { return _data + _size; }
+  char operator[](const size_t index) const { return _data[index]; }
+
+  operator std::string() const {
+    return std::string(_data, _size);
+  }
 
-  std::string flag;
-  std::string alias;
-  std::string description;
-  std::string fallback;
-  bool value = false;
+  bool operator==(const StringView& other) const {
+    return _size == other._size && (_size == 0 || std::memcmp(_data, other._data, _size) == 0);
+  }
+
+  bool operator!=(const StringView& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  const char* _data = "";
+  size_t _size = 0;
 };
 
-class Args {
+inline bool operator==(const std::string& lhs, const StringView& rhs) {
+  return StringView(lhs) == rhs;
+}
+
+inline bool operator==(const char* lhs, const StringView& rhs) {
+  return StringView(lhs) == rhs;
+}
+
+inline std::ostream& operator<<(std::ostream& output, const StringView& view) {
+  return output.write(view.data(), static_cast<std::streamsize>(view.size()));
+}
+
+// A read-only view of contiguous elements owned by someone else, like std::span in later standards
+template <typename T>
+class ArrayView {
  public:
-  Args() = default;
+  ArrayView() = default;
+  ArrayView(const T* data, const size_t size) : _data(data), _size(size) {}
 
-  ~Args() = default;
+  const T* data() const { return _data; }
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  const T* begin() const { return _data; }
+  const T* end() const { return _data + _size; }
+  const T& operator[](const size_t index) const { return _data[index]; }
 
-  static Args& Default() {
-    static Args instance;
-    return instance;
+ private:
+  const T* _data = nullptr;
+  size_t _size = 0;
+};
+
+//
+// Memory
+//
+// By default sargs allocates from the heap. Given an Arena, a Schema, ParseResult or Args instead takes
+// all of its registry and parse memory from a few large blocks, which are freed together when the arena
+// is released or destroyed. The arena can start in a buffer the caller provides, such as one on the
+// stack, and only goes to the heap once that is used up.
+//
+
+class Arena {
+ public:
+  Arena() = default;
+
+  // Uses buffer before going to the heap. buffer must outlive the arena. Without grow the arena never
+  // goes to the heap, and Allocate() returns null once buffer is used up.
+  Arena(void* buffer, const size_t size, const bool grow = true) :
+    _initial(static_cast<char*>(buffer)), _initial_size(size), _grow(grow) {
+    this->Rewind();
   }
 
-  bool GetAsString(const std::string& flag, std::string& value) const {
-    if (flag.empty()) {
-      if (_exceptions_enabled)
-        throw SargsError("Flag query empty");
-      else
-        return false;
-    }
+  Arena(Arena&& other) :
+    _initial(other._initial), _initial_size(other._initial_size), _grow(other._grow), _blocks(other._blocks),
+    _current(other._current), _end(other._end), _next_size(other._next_size), _used(other._used) {
+    other._blocks = nullptr;
+    other._initial = nullptr;
+    other._initial_size = 0;
+    other.Rewind();
+  }
 
-    auto iter = _arguments.find(flag);
-    if (iter == _arguments.end())
-      return false;
-    value = iter->second;
-    return true;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  ~Arena() {
+    this->Release();
   }
 
-  std::string GetAsString(const std::string& flag) const {
-    std::string value;
-    if (!this->GetAsString(flag, value))
-      return "";
-    return value;
+  void* Allocate(const size_t size, const size_t alignment) {
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(_current) % alignment) % alignment;
+    if (_current == nullptr || size + padding > static_cast<size_t>(_end - _current)) {
+      if (!_grow)
+        return nullptr;
+      this->AddBlock(size + alignment);
+      padding = (alignment - reinterpret_cast<uintptr_t>(_current) % alignment) % alignment;
+    }
+    char* memory = _current + padding;
+    _current = memory + size;
+    _used += size + padding;
+    return memory;
   }
 
-  bool GetAsFloat(const std::string& flag, float& value) const {
-    if (flag.empty()) {
-      if (_exceptions_enabled)
-        throw SargsError("Flag query empty");
-      else
-        return false;
+  // Frees every block taken from the heap and starts over in the caller's buffer. Anything allocated
+  // from the arena must no longer be used.
+  void Release() {
+    while (_blocks != nullptr) {
+      Block* next = _blocks->next;
+      ::operator delete(_blocks);
+      _blocks = next;
     }
+    this->Rewind();
+  }
 
-    auto iter = _arguments.find(flag);
-    if (iter == _arguments.end())
-      return false;
+  // Bytes handed out, including alignment padding
+  size_t GetBytesUsed() const {
+    return _used;
+  }
 
-    const std::string value_str(iter->second);
-    const float myvalue = std::strtof(value_str.c_str(), nullptr);
-    if (errno == ERANGE)
-      throw SargsError("Could not convert " +  value_str + " to float");
+  size_t GetBlockCount() const {
+    size_t count = 0;
+    for (const Block* block = _blocks; block != nullptr; block = block->next)
+      ++count;
+    return count;
+  }
 
-    value = myvalue;
-    return true;
+ private:
+  struct Block {
+    Block* next;
+  };
+
+  static const size_t kFirstBlockSize = 4096;
+
+  char* _initial = nullptr;
+  size_t _initial_size = 0;
+  bool _grow = true;
+  Block* _blocks = nullptr;
+  char* _current = nullptr;
+  char* _end = nullptr;
+  size_t _next_size = kFirstBlockSize;
+  size_t _used = 0;
+
+  void Rewind() {
+    _current = _initial;
+    _end = _initial + _initial_size;
+    _next_size = (_initial_size * 2 > kFirstBlockSize) ? _initial_size * 2 : kFirstBlockSize;
+    _used = 0;
   }
 
-  float GetAsFloat(const std::string& flag) const {
-    float value;
-    if (!this->GetAsFloat(flag, value))
-      return 0.0;
-    return value;
+  // Each block is at least twice the size of the last, so there are few of them
+  void AddBlock(const size_t size) {
+    while (_next_size < size + sizeof(Block))
+      _next_size *= 2;
+    Block* block = static_cast<Block*>(::operator new(_next_size));
+    block->next = _blocks;
+    _blocks = block;
+    _current = reinterpret_cast<char*>(block + 1);
+    _end = reinterpret_cast<char*>(block) + _next_size;
+    _next_size *= 2;
   }
+};
 
-  bool GetAsUInt64(const std::string& flag, uint64_t& value) const {
-    if (flag.empty()) {
-      if (_exceptions_enabled)
-        throw SargsError("Flag query empty");
-      else
-        return false;
+// A standard allocator taking memory from an Arena, or from the heap if it has none. Memory given back
+// to an arena is only reclaimed when the arena is released.
+template <typename T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  ArenaAllocator(Arena* arena = nullptr) : _arena(arena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : _arena(other.GetArena()) {}
+
+  T* allocate(const size_t count) {
+    if (_arena == nullptr)
+      return static_cast<T*>(::operator new(count * sizeof(T)));
+    void* memory = _arena->Allocate(count * sizeof(T), alignof(T));
+    if (memory == nullptr)
+      throw std::bad_alloc();
+    return static_cast<T*>(memory);
+  }
+
+  void deallocate(T* memory, const size_t) {
+    if (_arena == nullptr)
+      ::operator delete(memory);
+  }
+
+  Arena* GetArena() const {
+    return _arena;
+  }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return _arena == other.GetArena();
+  }
+
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const {
+    return _arena != other.GetArena();
+  }
+
+ private:
+  Arena* _arena;
+};
+
+// The containers sargs keeps its registry and parse state in
+template <typename T>
+using Vector = std::vector<T, ArenaAllocator<T>>;
+
+// Bytes an arena needs to reserve count elements of T, allowing for alignment
+template <typename T>
+constexpr size_t ReservedBytes(const size_t count) {
+  return count * sizeof(T) + alignof(T);
+}
+
+//
+// Fixed capacity
+//
+// Define SARGS_FIXED_CAPACITY before including sargs.h for programs that must not allocate once they are
+// running. Args then keeps its flags and parse state in a buffer of its own sized by the limits below,
+// values are views into argv and failures are reported through ParseResult::GetErrorCode() instead of
+// exceptions. Once flags are registered, Initialize() and the getters that return views, numbers or
+// presence never allocate. Response files, binary flags, parallel parsing and SARGS_TRACE each need the
+// heap and are left out.
+//
+
+#if defined(SARGS_FIXED_CAPACITY)
+// Flags that can be registered, counting --help
+#if !defined(SARGS_MAX_FLAGS)
+#define SARGS_MAX_FLAGS 64
+#endif
+
+// Arguments that can be parsed, counting argv[0]
+#if !defined(SARGS_MAX_ARGS)
+#define SARGS_MAX_ARGS 256
+#endif
+
+// Room for the names, descriptions and defaults of every flag, with a NUL after each
+#if !defined(SARGS_MAX_STRING_BYTES)
+#define SARGS_MAX_STRING_BYTES 4096
+#endif
+#endif
+
+typedef Vector<StringView> NonFlagList;
+
+//
+// Number conversion
+//
+// Conversions in the style of std::from_chars, which is not available in C++11. They never allocate,
+// do not depend on the current locale, report overflow exactly and leave the output untouched on
+// failure. Integers accept an optional sign and a 0x (hex), 0b (binary) or leading 0 (octal) prefix.
+// Floating point accepts decimal notation with an optional exponent, inf and nan.
+//
+
+enum class ConvertStatus {
+  kOk,
+  kInvalid,
+  kOutOfRange
+};
+
+struct ConvertResult {
+  const char* end;  // First character that was not consumed
+  ConvertStatus status;
+};
+
+inline unsigned DigitValue(const char c) {
+  if (c >= '0' && c <= '9')
+    return static_cast<unsigned>(c - '0');
+  if (c >= 'a' && c <= 'z')
+    return static_cast<unsigned>(c - 'a' + 10);
+  if (c >= 'A' && c <= 'Z')
+    return static_cast<unsigned>(c - 'A' + 10);
+  return 36;
+}
+
+// Parses an unsigned magnitude including its base prefix
+inline ConvertResult FromCharsMagnitude(const char* first, const char* last, uint64_t& value) {
+  const char* pos = first;
+  unsigned base = 10;
+  if (last - pos >= 2 && pos[0] == '0' && (pos[1] == 'x' || pos[1] == 'X')) {
+    base = 16;
+    pos += 2;
+  } else if (last - pos >= 2 && pos[0] == '0' && (pos[1] == 'b' || pos[1] == 'B')) {
+    base = 2;
+    pos += 2;
+  } else if (last - pos >= 2 && pos[0] == '0' && DigitValue(pos[1]) < 8) {
+    base = 8;
+    pos += 1;
+  }
+
+  const char* digits = pos;
+  const uint64_t max = std::numeric_limits<uint64_t>::max();
+  uint64_t result = 0;
+  bool overflow = false;
+  for (; pos != last; ++pos) {
+    const unsigned digit = DigitValue(*pos);
+    if (digit >= base)
+      break;
+    if (result > (max - digit) / base)
+      overflow = true;
+    else
+      result = result * base + digit;
+  }
+
+  if (pos == digits)
+    return ConvertResult{first, ConvertStatus::kInvalid};
+  if (overflow)
+    return ConvertResult{pos, ConvertStatus::kOutOfRange};
+  value = result;
+  return ConvertResult{pos, ConvertStatus::kOk};
+}
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, ConvertResult>::type
+FromChars(const char* first, const char* last, T& value) {
+  const char* pos = (first != last && *first == '+') ? first + 1 : first;
+  uint64_t magnitude = 0;
+  ConvertResult result = FromCharsMagnitude(pos, last, magnitude);
+  if (result.status == ConvertStatus::kInvalid)
+    return ConvertResult{first, ConvertStatus::kInvalid};
+  if (result.status == ConvertStatus::kOk && magnitude > std::numeric_limits<T>::max())
+    result.status = ConvertStatus::kOutOfRange;
+  if (result.status == ConvertStatus::kOk)
+    value = static_cast<T>(magnitude);
+  return result;
+}
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, ConvertResult>::type
+FromChars(const char* first, const char* last, T& value) {
+  const bool negative = (first != last && *first == '-');
+  const char* pos = (first != last && (*first == '-' || *first == '+')) ? first + 1 : first;
+  uint64_t magnitude = 0;
+  ConvertResult result = FromCharsMagnitude(pos, last, magnitude);
+  if (result.status == ConvertStatus::kInvalid)
+    return ConvertResult{first, ConvertStatus::kInvalid};
+
+  // The most negative value has one more unit of magnitude than the most positive one
+  const uint64_t limit = static_cast<uint64_t>(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+  if (result.status == ConvertStatus::kOk && magnitude > limit)
+    result.status = ConvertStatus::kOutOfRange;
+  if (result.status == ConvertStatus::kOk && !negative)
+    value = static_cast<T>(magnitude);
+  else if (result.status == ConvertStatus::kOk)
+    value = (magnitude == 0) ? T(0) : static_cast<T>(-static_cast<int64_t>(magnitude - 1) - 1);
+  return result;
+}
+
+inline double StringToFloating(const char* text, double*) {
+  return std::strtod(text, nullptr);
+}
+
+inline float StringToFloating(const char* text, float*) {
+  return std::strtof(text, nullptr);
+}
+
+template <typename T>
+struct FloatingTraits;
+
+// Powers of ten that are exact in the type, and the largest integer it holds exactly
+template <>
+struct FloatingTraits<double> {
+  static const int kMaxExactPower = 22;
+  static const uint64_t kMaxExactInteger = uint64_t(1) << 53;
+};
+
+template <>
+struct FloatingTraits<float> {
+  static const int kMaxExactPower = 10;
+  static const uint64_t kMaxExactInteger = uint64_t(1) << 24;
+};
+
+inline bool MatchesWord(const char* first, const char* last, const char* word) {
+  for (; *word != '\0'; ++word, ++first) {
+    if (first == last || (*first | 0x20) != *word)
+      return false;
+  }
+  return true;
+}
+
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value, ConvertResult>::type
+FromChars(const char* first, const char* last, T& value) {
+  const char* pos = first;
+  const bool negative = (pos != last && *pos == '-');
+  if (pos != last && (*pos == '-' || *pos == '+'))
+    ++pos;
+
+  if (MatchesWord(pos, last, "inf")) {
+    pos += MatchesWord(pos, last, "infinity") ? 8 : 3;
+    value = negative ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+    return ConvertResult{pos, ConvertStatus::kOk};
+  }
+  if (MatchesWord(pos, last, "nan")) {
+    value = std::numeric_limits<T>::quiet_NaN();
+    return ConvertResult{pos + 3, ConvertStatus::kOk};
+  }
+
+  // Up to this many significant digits are kept, which is enough to round any double correctly. Any
+  // further non-zero digit is recorded as a trailing 1 so the value still rounds the right way.
+  static const int kMaxDigits = 780;
+  char digits[kMaxDigits + 2];
+  int digit_count = 0;
+  int64_t exponent = 0;
+  bool truncated = false;
+  uint64_t mantissa = 0;
+  bool seen_digit = false;
+  bool seen_point = false;
+  for (; pos != last; ++pos) {
+    if (*pos == '.' && !seen_point) {
+      seen_point = true;
+      continue;
+    }
+    if (*pos < '0' || *pos > '9')
+      break;
+    seen_digit = true;
+    if (digit_count == 0 && *pos == '0') {
+      if (seen_point)
+        --exponent;
+      continue;
+    }
+    if (digit_count < kMaxDigits) {
+      if (digit_count < 19)
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*pos - '0');
+      digits[digit_count++] = *pos;
+      if (seen_point)
+        --exponent;
+    } else {
+      truncated = truncated || (*pos != '0');
+      if (!seen_point)
+        ++exponent;
     }
+  }
+  if (!seen_digit)
+    return ConvertResult{first, ConvertStatus::kInvalid};
+
+  // The exponent is only consumed when it has at least one digit
+  if (pos != last && (*pos == 'e' || *pos == 'E')) {
+    const char* exp_pos = pos + 1;
+    const bool exp_negative = (exp_pos != last && *exp_pos == '-');
+    if (exp_pos != last && (*exp_pos == '-' || *exp_pos == '+'))
+      ++exp_pos;
+    if (exp_pos != last && *exp_pos >= '0' && *exp_pos <= '9') {
+      int64_t exp_value = 0;
+      for (; exp_pos != last && *exp_pos >= '0' && *exp_pos <= '9'; ++exp_pos) {
+        if (exp_value < 100000)
+          exp_value = exp_value * 10 + (*exp_pos - '0');
+      }
+      exponent += exp_negative ? -exp_value : exp_value;
+      pos = exp_pos;
+    }
+  }
 
-    auto iter = _arguments.find(flag);
-    if (iter == _arguments.end())
+  if (digit_count == 0) {
+    value = negative ? -T(0) : T(0);
+    return ConvertResult{pos, ConvertStatus::kOk};
+  }
+
+  // Exact when both the digits and the power of ten are exactly representable
+  const int max_power = FloatingTraits<T>::kMaxExactPower;
+  if (digit_count <= 19 && mantissa <= FloatingTraits<T>::kMaxExactInteger && exponent >= -max_power &&
+      exponent <= max_power) {
+    static const T kPowers[] = {T(1e0), T(1e1), T(1e2), T(1e3), T(1e4), T(1e5), T(1e6), T(1e7),
+                                T(1e8), T(1e9), T(1e10), T(1e11), T(1e12), T(1e13), T(1e14), T(1e15),
+                                T(1e16), T(1e17), T(1e18), T(1e19), T(1e20), T(1e21), T(1e22)};
+    T result = static_cast<T>(mantissa);
+    result = (exponent < 0) ? result / kPowers[-exponent] : result * kPowers[exponent];
+    value = negative ? -result : result;
+    return ConvertResult{pos, ConvertStatus::kOk};
+  }
+
+  // Otherwise let the C library round it. The digits are written as an integer with an exponent, so
+  // there is no decimal point for the locale to change the meaning of.
+  char text[kMaxDigits + 32];
+  int length = 0;
+  if (negative)
+    text[length++] = '-';
+  std::memcpy(text + length, digits, static_cast<size_t>(digit_count));
+  length += digit_count;
+  if (truncated) {
+    text[length++] = '1';
+    --exponent;
+  }
+  text[length++] = 'e';
+  if (exponent < 0) {
+    text[length++] = '-';
+    exponent = -exponent;
+  }
+  char exponent_digits[24];
+  int exponent_length = 0;
+  do {
+    exponent_digits[exponent_length++] = static_cast<char>('0' + exponent % 10);
+    exponent /= 10;
+  } while (exponent != 0);
+  while (exponent_length > 0)
+    text[length++] = exponent_digits[--exponent_length];
+  text[length] = '\0';
+  const T result = StringToFloating(text, static_cast<T*>(nullptr));
+  if (result == std::numeric_limits<T>::infinity() || result == -std::numeric_limits<T>::infinity())
+    return ConvertResult{pos, ConvertStatus::kOutOfRange};
+  value = result;
+  return ConvertResult{pos, ConvertStatus::kOk};
+}
+
+// Converts all of text, rejecting anything left over after the number
+template <typename T>
+bool ConvertNumber(const char* text, const size_t size, T& value) {
+  T parsed = T();
+  const ConvertResult result = FromChars(text, text + size, parsed);
+  if (result.status != ConvertStatus::kOk || result.end != text + size)
+    return false;
+  value = parsed;
+  return true;
+}
+
+// Converts a list such as "1.5,2,3" into values, replacing its contents. The separators are counted first
+// so values is sized once, then each number is converted straight into place. On failure error_offset is
+// the position in text of the element that could not be converted, or of a missing element.
+template <typename T>
+bool ConvertList(const char* text, const size_t size, const char separator, std::vector<T>& values,
+                 size_t& error_offset) {
+  values.clear();
+  if (size == 0)
+    return true;
+
+  const char* const last = text + size;
+  values.resize(static_cast<size_t>(std::count(text, last, separator)) + 1);
+  const char* pos = text;
+  for (T& value : values) {
+    const ConvertResult result = FromChars(pos, last, value);
+    if (result.status != ConvertStatus::kOk || (result.end != last && *result.end != separator)) {
+      error_offset = static_cast<size_t>(pos - text);
+      values.clear();
       return false;
+    }
+    pos = result.end + 1;
+  }
+  return true;
+}
+
+// Identifies a registered flag. Ids are handed out in registration order and a flag and its alias
+// resolve to the same id, so both names share one value slot.
+typedef uint32_t FlagId;
+const FlagId kUnknownFlag = 0xFFFFFFFF;
+
+// Receives each non-flag while it is parsed. The view is only valid during the call.
+typedef std::function<void(const StringView&)> NonFlagHandler;
+
+//
+// Statistics
+//
+// Define SARGS_ENABLE_STATS before including sargs.h to count what the parser does. Otherwise the
+// counting code is compiled out and every statistic reads as zero.
+//
 
-    const std::string value_str(iter->second);
-#if defined(__linux) || defined(__clang__)
-    const uint64_t myvalue = std::strtoul(value_str.c_str(), nullptr, 0);
-#elif defined(_WIN32)
-    const uint64_t myvalue = std::strtoull(value_str.c_str(), nullptr, 0);
+#if defined(SARGS_ENABLE_STATS)
+#define SARGS_STATS(...) __VA_ARGS__
+#else
+#define SARGS_STATS(...)
 #endif
-    const bool range_error = (errno == ERANGE);
-    if (range_error) {
-      if (_exceptions_enabled)
-        throw SargsError("Could not convert " +  value_str + " to uint64_t");
-      else
+
+// What the last parse into a result did, and what has been read from it since. Times are in nanoseconds.
+struct ParseStats {
+#if defined(SARGS_ENABLE_STATS)
+  static const bool kEnabled = true;
+#else
+  static const bool kEnabled = false;
+#endif
+
+  uint64_t tokens = 0;                // Arguments parsed, after expanding response files
+  uint64_t lookups = 0;               // Flag name lookups, while parsing and by the getters
+  uint64_t probes = 0;                // Index slots compared during those lookups
+  uint64_t allocations = 0;           // Times a container of the result grew while parsing
+  uint64_t storage_bytes = 0;         // Capacity of the buffer values and non-flags are copied into
+  uint64_t retained_bytes = 0;        // Capacity of everything the result holds, storage included
+  uint64_t string_conversions = 0;    // GetAsString and GetAsStringView
+  uint64_t float_conversions = 0;     // GetAsFloat
+  uint64_t integer_conversions = 0;   // GetAsUInt* and GetAsInt*
+  uint64_t list_conversions = 0;      // GetAs*List and GetAll*
+  uint64_t array_conversions = 0;     // GetAsArray
+  uint64_t parse_ns = 0;              // All of Schema::Parse()
+  uint64_t check_values_ns = 0;       // Checking that value flags have values
+  uint64_t fallback_ns = 0;           // Applying default values
+  uint64_t usage_ns = 0;              // Generating the usage
+
+  // Calls visit(name, value) for each statistic, to export them to a metrics system
+  template <typename Visitor>
+  void ForEach(Visitor visit) const {
+    visit("tokens", tokens);
+    visit("lookups", lookups);
+    visit("probes", probes);
+    visit("allocations", allocations);
+    visit("storage_bytes", storage_bytes);
+    visit("retained_bytes", retained_bytes);
+    visit("string_conversions", string_conversions);
+    visit("float_conversions", float_conversions);
+    visit("integer_conversions", integer_conversions);
+    visit("list_conversions", list_conversions);
+    visit("array_conversions", array_conversions);
+    visit("parse_ns", parse_ns);
+    visit("check_values_ns", check_values_ns);
+    visit("fallback_ns", fallback_ns);
+    visit("usage_ns", usage_ns);
+  }
+};
+
+// Writes one "name value" line per statistic
+inline std::ostream& operator<<(std::ostream& output, const ParseStats& stats) {
+  stats.ForEach([&](const char* name, const uint64_t value) { output << name << ' ' << value << '\n'; });
+  return output;
+}
+
+#if defined(SARGS_ENABLE_STATS)
+// Adds the time between construction and destruction to a statistic
+class StatsTimer {
+ public:
+  explicit StatsTimer(uint64_t& total) : _total(total), _start(std::chrono::steady_clock::now()) {}
+
+  ~StatsTimer() {
+    const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - _start;
+    _total += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  }
+
+ private:
+  uint64_t& _total;
+  std::chrono::steady_clock::time_point _start;
+};
+#endif
+
+//
+// Tracing
+//
+// A Tracer records how long each phase of parsing took and writes it as Chrome trace_event JSON, which
+// can be loaded in chrome://tracing or Perfetto. Tracing is off unless a tracer is given to Args or a
+// ParseResult, or the SARGS_TRACE environment variable names the file to write. Set SARGS_TRACE_TOKENS=1
+// as well to record an event for every argument.
+//
+
+class Tracer {
+ public:
+  explicit Tracer(const std::string& path, const bool token_events = false) :
+    _path(path), _token_events(token_events), _epoch(std::chrono::steady_clock::now()) {}
+
+  Tracer(const Tracer&) = delete;
+  Tracer& operator=(const Tracer&) = delete;
+
+  // Closes the JSON array so the file is complete
+  ~Tracer() {
+    if (_output.is_open())
+      _output << "\n]\n";
+  }
+
+  // Returns a tracer writing to the file named by SARGS_TRACE, or null if it is not set
+  static std::unique_ptr<Tracer> FromEnvironment() {
+    const char* path = std::getenv("SARGS_TRACE");
+    if (path == nullptr || path[0] == '\0')
+      return std::unique_ptr<Tracer>();
+    const char* tokens = std::getenv("SARGS_TRACE_TOKENS");
+    const bool token_events = tokens != nullptr && tokens[0] != '\0' && tokens[0] != '0';
+    return std::unique_ptr<Tracer>(new Tracer(path, token_events));
+  }
+
+  bool TokenEventsEnabled() const {
+    return _token_events;
+  }
+
+  // Nanoseconds since the tracer was created
+  int64_t Now() const {
+    const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - _epoch;
+    return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  }
+
+  void AddSpan(const char* name, const int64_t start_ns, const int64_t end_ns) {
+    Event event = { StringView(name, std::strlen(name)), start_ns, end_ns, kNoIndex };
+    _events.push_back(event);
+  }
+
+  // Token is only referenced, so it must stay valid until the next Flush()
+  void AddToken(const StringView& token, const size_t index, const int64_t start_ns, const int64_t end_ns) {
+    Event event = { token, start_ns, end_ns, index };
+    _events.push_back(event);
+  }
+
+  // Appends the events recorded so far to the file and forgets them. The file is created on the first call.
+  bool Flush() {
+    if (!_output.is_open()) {
+      _output.open(_path.c_str(), std::ios::out | std::ios::trunc);
+      if (!_output)
         return false;
+      _output << "[";
+    }
+    for (const Event& event : _events) {
+      _output << (_written++ == 0 ? "\n" : ",\n") << "  {\"name\": \"";
+      WriteEscaped(_output, event.name);
+      _output << "\", \"cat\": \"" << (event.index == kNoIndex ? "sargs" : "sargs.token")
+              << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": ";
+      WriteMicroseconds(_output, event.start_ns);
+      _output << ", \"dur\": ";
+      WriteMicroseconds(_output, event.end_ns - event.start_ns);
+      if (event.index != kNoIndex)
+        _output << ", \"args\": {\"index\": " << event.index << "}";
+      _output << "}";
     }
+    _events.clear();
+    _output.flush();
+    return static_cast<bool>(_output);
+  }
 
-    value = myvalue;
-    return true;
+ private:
+  static const size_t kNoIndex = static_cast<size_t>(-1);
+
+  struct Event {
+    StringView name;
+    int64_t start_ns;
+    int64_t end_ns;
+    size_t index;
+  };
+
+  std::string _path;
+  bool _token_events;
+  std::chrono::steady_clock::time_point _epoch;
+  std::vector<Event> _events;
+  std::ofstream _output;
+  size_t _written = 0;
+
+  static void WriteMicroseconds(std::ostream& output, const int64_t ns) {
+    const char fill = output.fill('0');
+    output << ns / 1000 << '.' << std::setw(3) << ns % 1000;
+    output.fill(fill);
   }
 
-  uint64_t GetAsUInt64(const std::string& flag) const {
-    uint64_t value;
-    if (!this->GetAsUInt64(flag, value)) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " was not specified");
+  static void WriteEscaped(std::ostream& output, const StringView& text) {
+    static const char kHex[] = "0123456789abcdef";
+    for (size_t i = 0; i < text.size(); ++i) {
+      const unsigned char c = static_cast<unsigned char>(text.data()[i]);
+      if (c == '"' || c == '\\')
+        output << '\\' << static_cast<char>(c);
+      else if (c < 0x20)
+        output << "\\u00" << kHex[c >> 4] << kHex[c & 0xf];
       else
-        return 0;
+        output << static_cast<char>(c);
     }
-    return value;
+  }
+};
+
+// Records the time from construction to destruction as a span. Does nothing without a tracer.
+class TraceSpan {
+ public:
+  TraceSpan(Tracer* tracer, const char* name) :
+    _tracer(tracer), _name(name), _start(tracer != nullptr ? tracer->Now() : 0) {}
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+  ~TraceSpan() {
+    this->End();
   }
 
-  uint32_t GetAsUInt32(const std::string& flag) const {
-    uint64_t value;
-    if (!this->GetAsUInt64(flag, value)) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " was not specified");
-      else
-        return 0;
+  // Records the span now rather than on destruction
+  void End() {
+    if (_tracer != nullptr)
+      _tracer->AddSpan(_name, _start, _tracer->Now());
+    _tracer = nullptr;
+  }
+
+ private:
+  Tracer* _tracer;
+  const char* _name;
+  int64_t _start;
+};
+
+// Records one event per argument while tokens are parsed, if the tracer asks for them
+class TokenTrace {
+ public:
+  explicit TokenTrace(Tracer* tracer) :
+    _tracer((tracer != nullptr && tracer->TokenEventsEnabled()) ? tracer : nullptr) {}
+
+  TokenTrace(const TokenTrace&) = delete;
+  TokenTrace& operator=(const TokenTrace&) = delete;
+
+  ~TokenTrace() {
+    this->End();
+  }
+
+  // Ends the previous token's event and starts one for token
+  void Next(const StringView& token, const size_t index) {
+    if (_tracer == nullptr)
+      return;
+    const int64_t now = _tracer->Now();
+    if (_active)
+      _tracer->AddToken(_token, _index, _start, now);
+    _token = token;
+    _index = index;
+    _start = now;
+    _active = true;
+  }
+
+  void End() {
+    if (_tracer != nullptr && _active)
+      _tracer->AddToken(_token, _index, _start, _tracer->Now());
+    _active = false;
+  }
+
+ private:
+  Tracer* _tracer;
+  StringView _token;
+  size_t _index = 0;
+  int64_t _start = 0;
+  bool _active = false;
+};
+
+// The strings of a registered argument are views of copies kept by the Schema
+struct Argument {
+  Argument(const StringView& _flag,
+           const StringView& _alias,
+           const StringView& _description,
+           const bool _value) :
+    flag(_flag), alias(_alias), description(_description), value(_value) {}
+
+  Argument(const StringView& _flag,
+           const StringView& _alias,
+           const StringView& _description,
+           const bool _value,
+           const StringView& _fallback) :
+    flag(_flag), alias(_alias), description(_description), fallback(_fallback), value(_value) {}
+
+  StringView flag;
+  StringView alias;
+  StringView description;
+  StringView fallback;
+  bool value = false;
+  bool required = false;
+  // Keeps every value given instead of only the last one
+  bool repeated = false;
+  // The value names a file whose contents are mapped as an array
+  bool binary = false;
+};
+
+// Maps flag and alias names to the id of the Argument they were registered with. Built once by
+// Args::Initialize() so each token can be classified with a single open-addressing probe sequence.
+// Only hashes and ids are stored; the caller verifies a candidate id against the real names.
+class FlagIndex {
+ public:
+  static const uint32_t kNotFound = kUnknownFlag;
+
+  explicit FlagIndex(Arena* arena = nullptr) : _slots(ArenaAllocator<Slot>(arena)) {}
+
+  // What one pass over an argument found: the hash of all of it and, if it has an '=', the hash of the
+  // name before it
+  struct Scan {
+    uint64_t hash;
+    uint64_t name_hash;
+    // Offset of the first '=', or the size of the argument if there is none
+    size_t separator;
+  };
+
+  static uint64_t Hash(const char* name, const size_t size) {
+    uint64_t hash = kOffsetBasis;
+    for (size_t i = 0; i < size; ++i)
+      hash = Step(hash, name[i]);
+    return hash;
+  }
+
+  // Reads arg once, from the left. The name state ends at the first '=', where its hash is kept, and the
+  // rest only adds to the hash of the whole argument.
+  static Scan ScanArgument(const char* arg, const size_t size) {
+    Scan scan = { kOffsetBasis, kOffsetBasis, size };
+    size_t i = 0;
+    for (; i < size && arg[i] != '='; ++i)
+      scan.hash = Step(scan.hash, arg[i]);
+    if (i < size) {
+      scan.name_hash = scan.hash;
+      scan.separator = i;
     }
-    if (value > std::numeric_limits<uint32_t>::max()) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " was too large for uint32_t");
-      else
-        return 0;
-    } else if (value < std::numeric_limits<uint32_t>::min()) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " was too low for uint32_t");
-      else
-        return 0;
+    for (; i < size; ++i)
+      scan.hash = Step(scan.hash, arg[i]);
+    return scan;
+  }
+
+  // Slots needed to index names, a power of two at most half full
+  static constexpr size_t Capacity(const size_t names, const size_t capacity = 16) {
+    return (capacity < names * 2) ? Capacity(names, capacity << 1) : capacity;
+  }
+
+  static constexpr size_t ReservedBytes(const size_t names) {
+    return sargs::ReservedBytes<Slot>(Capacity(names));
+  }
+
+  void Reserve(const size_t names) {
+    _slots.reserve(Capacity(names));
+  }
+
+  void Reset(const size_t names) {
+    const size_t capacity = Capacity(names);
+    _slots.assign(capacity, Slot());
+    _mask = capacity - 1;
+  }
+
+  // Returns the first id stored under hash that matches accepts, or kNotFound
+  template <typename Matches>
+  uint32_t Find(const uint64_t hash, Matches matches) const {
+    size_t probes = 0;
+    return this->Find(hash, matches, probes);
+  }
+
+  // As above, adding the number of slots compared to probes
+  template <typename Matches>
+  uint32_t Find(const uint64_t hash, Matches matches, size_t& probes) const {
+    if (_slots.empty())
+      return kNotFound;
+    for (size_t pos = hash & _mask; _slots[pos].id != kNotFound; pos = (pos + 1) & _mask) {
+      ++probes;
+      if (_slots[pos].hash == hash && matches(_slots[pos].id))
+        return _slots[pos].id;
     }
-    return static_cast<uint32_t>(value);
+    return kNotFound;
   }
 
-  uint16_t GetAsUInt16(const std::string& flag) const {
-    uint64_t value;
-    if (!this->GetAsUInt64(flag, value)) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " was not specified");
+  void Insert(const uint64_t hash, const uint32_t id) {
+    size_t pos = hash & _mask;
+    while (_slots[pos].id != kNotFound)
+      pos = (pos + 1) & _mask;
+    _slots[pos].hash = hash;
+    _slots[pos].id = id;
+  }
+
+ private:
+  struct Slot {
+    uint64_t hash = 0;
+    uint32_t id = kNotFound;
+  };
+
+  static const uint64_t kOffsetBasis = 14695981039346656037ULL;
+
+  Vector<Slot> _slots;
+  size_t _mask = 0;
+
+  static uint64_t Step(const uint64_t hash, const char c) {
+    return (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+  }
+};
+
+// A set of byte values, used to rule out arguments that cannot name a flag from their first bytes
+class ByteSet {
+ public:
+  void Clear() {
+    std::fill(_bits, _bits + 4, 0);
+  }
+
+  void Insert(const char c) {
+    const unsigned char byte = static_cast<unsigned char>(c);
+    _bits[byte >> 6] |= uint64_t(1) << (byte & 63);
+  }
+
+  bool Contains(const char c) const {
+    const unsigned char byte = static_cast<unsigned char>(c);
+    return (_bits[byte >> 6] >> (byte & 63)) & 1;
+  }
+
+ private:
+  uint64_t _bits[4] = { 0, 0, 0, 0 };
+};
+
+// How an argument reads on its own, before the arguments around it are taken into account
+struct TokenClass {
+  enum Kind : uint8_t {
+    kNonFlag,
+    kFlag,        // The name of a flag
+    kSplit,       // name=value
+    kShortGroup,  // One character names run together, as in -abc or -p2
+  };
+
+  Kind kind;
+  // The flag named, or for kShortGroup the one taking a value, kUnknownFlag if none does
+  FlagId id;
+  // For kSplit the offset of the '=', for kShortGroup the offset after the last flag character
+  size_t offset;
+};
+
+// A file mapped into memory. Response files are mapped copy-on-write, so they can be split into NUL
+// terminated tokens in place without reading them up front or changing them on disk; binary flag values
+// are mapped read-only. The byte after the contents is always a NUL.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+#if !defined(_WIN32)
+    if (_data != nullptr)
+      munmap(_data, _mapped);
+#endif
+  }
+
+  bool Open(const char* path, const bool writable = true) {
+#if !defined(_WIN32)
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+      close(fd);
+      return false;
+    }
+
+    // Reserve one page more than the file needs, then map the file over the front of it. Whatever is
+    // left of that reservation past the end of the file reads as zeros.
+    _size = static_cast<size_t>(info.st_size);
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    _mapped = (_size / page + 1) * page;
+    const int protection = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void* region = mmap(nullptr, _mapped, protection, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    if (_size > 0 &&
+        mmap(region, _size, protection, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+      munmap(region, _mapped);
+      close(fd);
+      return false;
+    }
+    close(fd);
+    _data = static_cast<char*>(region);
+    return true;
+#else
+    FILE* file = std::fopen(path, "rb");
+    if (file == nullptr)
+      return false;
+    char chunk[4096];
+    size_t count = 0;
+    while ((count = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+      _buffer.insert(_buffer.end(), chunk, chunk + count);
+    std::fclose(file);
+    _size = _buffer.size();
+    _buffer.push_back('\0');
+    _data = _buffer.data();
+    (void)writable;
+    return true;
+#endif
+  }
+
+  const char* data() const {
+    return _data;
+  }
+
+  size_t size() const {
+    return _size;
+  }
+
+  // Returns the next token starting at offset and advances past it, or false at the end of the file.
+  // A file containing any NUL is split on NULs only, so tokens may hold spaces; otherwise tokens are
+  // separated by whitespace, which covers one per line and space separated files. Whitespace may be
+  // kept in a token by quoting it in ' or ", or by escaping it with a backslash, as gcc does.
+  bool NextToken(size_t& offset, StringView& token) {
+    if (offset == 0)
+      _nul_delimited = (_size > 0 && std::memchr(_data, '\0', _size) != nullptr);
+
+    char* const end = _data + _size;
+    char* pos = _data + offset;
+    while (pos != end && (_nul_delimited ? *pos == '\0' : std::isspace(static_cast<unsigned char>(*pos))))
+      ++pos;
+    if (pos == end)
+      return false;
+
+    char* token_end = pos;
+    char* next = pos;
+    if (_nul_delimited) {
+      token_end += std::strlen(pos);
+      next = token_end;
+    } else {
+      // Quotes and backslashes are dropped by moving the rest of the token down over them, so a token
+      // without any is never written to
+      char quote = '\0';
+      while (next != end && (quote != '\0' || !std::isspace(static_cast<unsigned char>(*next)))) {
+        if (*next == '\\' && next + 1 != end) {
+          ++next;
+        } else if (quote != '\0' ? *next == quote : (*next == '\'' || *next == '"')) {
+          quote = (quote != '\0') ? '\0' : *next;
+          ++next;
+          continue;
+        }
+        if (token_end != next)
+          *token_end = *next;
+        ++token_end;
+        ++next;
+      }
+    }
+
+    // Only pages holding a delimiter that is not already a NUL get copied
+    if (token_end != end && *token_end != '\0')
+      *token_end = '\0';
+    token = StringView(pos, static_cast<size_t>(token_end - pos));
+    offset = static_cast<size_t>(next - _data) + (next != end ? 1 : 0);
+    return true;
+  }
+
+ private:
+  char* _data = nullptr;
+  size_t _size = 0;
+  size_t _mapped = 0;
+  bool _nul_delimited = false;
+#if defined(_WIN32)
+  std::vector<char> _buffer;
+#endif
+};
+
+// Presents argv with the same interface as a list of tokens read from response files
+struct ArgvTokens {
+  int argc;
+  char** argv;
+
+  size_t size() const {
+    return static_cast<size_t>(argc);
+  }
+
+  StringView operator[](const size_t index) const {
+    return StringView(argv[index], std::strlen(argv[index]));
+  }
+};
+
+class Args;
+class ParseResult;
+
+// Storage behind a typed Flag handle. Filled once at the end of Args::Initialize().
+struct FlagSlot {
+  FlagSlot(const StringView& _flag, const FlagId _id) : flag(_flag), id(_id) {}
+  virtual ~FlagSlot() = default;
+  virtual void Load(const ParseResult& result) = 0;
+
+  std::string flag;
+  FlagId id;
+  bool present = false;
+};
+
+template <typename T>
+struct TypedFlagSlot : public FlagSlot {
+  TypedFlagSlot(const StringView& _flag, const FlagId _id) : FlagSlot(_flag, _id), value() {}
+  void Load(const ParseResult& result) override;
+
+  T value;
+};
+
+// Flags stored in a bool take no value; all other types take one
+template <typename T>
+struct StaticTakesValue {
+  static const bool value = true;
+};
+
+template <>
+struct StaticTakesValue<bool> {
+  static const bool value = false;
+};
+
+// Writes a flag straight into a caller owned variable at the end of Args::Initialize(). The variable is
+// left alone when the flag was not given, so its initial value acts as the default.
+template <typename T>
+struct BoundFlagSlot : public FlagSlot {
+  BoundFlagSlot(const StringView& _flag, const FlagId _id, T* _target) : FlagSlot(_flag, _id), target(_target) {}
+  void Load(const ParseResult& result) override;
+
+  T* target;
+};
+
+// Handle to a value flag that was converted and range checked during Args::Initialize(). Reading it
+// is a plain load, so it can be used in hot code in place of the SARGS_GET_* macros.
+template <typename T>
+class Flag {
+ public:
+  // Refers to no flag until a registration is assigned to it. Has() is then false, and Get() must not
+  // be called.
+  Flag() = default;
+
+  const T& Get() const {
+    return _slot->value;
+  }
+
+  const T& operator*() const {
+    return _slot->value;
+  }
+
+  bool Has() const {
+    return _slot != nullptr && _slot->present;
+  }
+
+ private:
+  friend class Args;
+  explicit Flag(const TypedFlagSlot<T>* slot) : _slot(slot) {}
+
+  const TypedFlagSlot<T>* _slot = nullptr;
+};
+
+// Returned when registering a value flag. Converting it to a Flag<T> asks Args to convert the value
+// to T during initialization, e.g. sargs::Flag<uint32_t> batch = SARGS_OPTIONAL_FLAG_VALUE(...);
+// It also converts to the FlagId of the new flag.
+class FlagRegistration {
+ public:
+  FlagRegistration(Args& args, const StringView& flag, const FlagId id) : _args(args), _flag(flag), _id(id) {}
+
+  template <typename T>
+  operator Flag<T>() const;
+
+  operator FlagId() const {
+    return _id;
+  }
+
+ private:
+  Args& _args;
+  // Only used while the registration converts, so the caller's name is still valid
+  StringView _flag;
+  FlagId _id;
+};
+
+class Schema;
+
+// The values and non-flags produced by Schema::Parse(). Views returned by a result point into argv or
+// into storage owned by the result, so a result can be moved but not copied.
+class ParseResult {
+ public:
+  ParseResult() = default;
+
+  // Takes all of its memory, other than for mapped files, from arena, which must outlive the result
+  explicit ParseResult(Arena* arena) :
+    _values(arena), _present(arena), _nonflags(arena), _repeated_pending(arena), _repeated_values(arena),
+    _repeated_offsets(arena), _storage(arena), _tokens(arena), _binary_values(arena), _classes(arena) {}
+
+  ParseResult(ParseResult&&) = default;
+  ParseResult& operator=(ParseResult&&) = default;
+  ParseResult(const ParseResult&) = delete;
+  ParseResult& operator=(const ParseResult&) = delete;
+
+  bool GetAsString(const StringView& flag, std::string& value) const {
+    if (flag.empty()) {
+      if (_exceptions_enabled)
+        throw SargsError("Flag query empty");
+      else
+        return false;
+    }
+
+    const StringView* found = this->Find(flag);
+    if (found == nullptr)
+      return false;
+    SARGS_STATS(++_stats.string_conversions;)
+    value.assign(found->data(), found->size());
+    return true;
+  }
+
+  bool GetAsStringView(const StringView& flag, StringView& value) const {
+    if (flag.empty()) {
+      if (_exceptions_enabled)
+        throw SargsError("Flag query empty");
+      else
+        return false;
+    }
+
+    const StringView* found = this->Find(flag);
+    if (found == nullptr)
+      return false;
+    SARGS_STATS(++_stats.string_conversions;)
+    value = *found;
+    return true;
+  }
+
+  StringView GetAsStringView(const StringView& flag) const {
+    StringView value;
+    this->GetAsStringView(flag, value);
+    return value;
+  }
+
+  std::string GetAsString(const StringView& flag) const {
+    std::string value;
+    if (!this->GetAsString(flag, value))
+      return "";
+    return value;
+  }
+
+  bool GetAsFloat(const StringView& flag, float& value) const {
+    if (flag.empty()) {
+      if (_exceptions_enabled)
+        throw SargsError("Flag query empty");
+      else
+        return false;
+    }
+
+    const StringView* found = this->Find(flag);
+    if (found == nullptr)
+      return false;
+    SARGS_STATS(++_stats.float_conversions;)
+
+    float myvalue = 0.0f;
+    if (!ConvertNumber(found->data(), found->size(), myvalue)) {
+      if (_exceptions_enabled)
+        throw SargsError("Could not convert " + std::string(*found) + " to float");
+      else
+        return false;
+    }
+
+    value = myvalue;
+    return true;
+  }
+
+  float GetAsFloat(const StringView& flag) const {
+    float value;
+    if (!this->GetAsFloat(flag, value))
+      return 0.0;
+    return value;
+  }
+
+  bool GetAsDouble(const StringView& flag, double& value) const {
+    if (flag.empty()) {
+      if (_exceptions_enabled)
+        throw SargsError("Flag query empty");
+      else
+        return false;
+    }
+
+    const StringView* found = this->Find(flag);
+    if (found == nullptr)
+      return false;
+    SARGS_STATS(++_stats.float_conversions;)
+
+    double myvalue = 0.0;
+    if (!ConvertNumber(found->data(), found->size(), myvalue)) {
+      if (_exceptions_enabled)
+        throw SargsError("Could not convert " + std::string(*found) + " to double");
+      else
+        return false;
+    }
+
+    value = myvalue;
+    return true;
+  }
+
+  double GetAsDouble(const StringView& flag) const {
+    double value;
+    if (!this->GetAsDouble(flag, value))
+      return 0.0;
+    return value;
+  }
+
+  bool GetAsUInt64(const StringView& flag, uint64_t& value) const {
+    if (flag.empty()) {
+      if (_exceptions_enabled)
+        throw SargsError("Flag query empty");
+      else
+        return false;
+    }
+
+    const StringView* found = this->Find(flag);
+    if (found == nullptr)
+      return false;
+    SARGS_STATS(++_stats.integer_conversions;)
+
+    uint64_t myvalue = 0;
+    if (!ConvertNumber(found->data(), found->size(), myvalue)) {
+      if (_exceptions_enabled)
+        throw SargsError("Could not convert " + std::string(*found) + " to uint64_t");
+      else
+        return false;
+    }
+
+    value = myvalue;
+    return true;
+  }
+
+  uint64_t GetAsUInt64(const StringView& flag) const {
+    uint64_t value;
+    if (!this->GetAsUInt64(flag, value)) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " was not specified");
+      else
+        return 0;
+    }
+    return value;
+  }
+
+  uint32_t GetAsUInt32(const StringView& flag) const {
+    uint64_t value;
+    if (!this->GetAsUInt64(flag, value)) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " was not specified");
+      else
+        return 0;
+    }
+    if (value > std::numeric_limits<uint32_t>::max()) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " was too large for uint32_t");
+      else
+        return 0;
+    } else if (value < std::numeric_limits<uint32_t>::min()) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " was too low for uint32_t");
+      else
+        return 0;
+    }
+    return static_cast<uint32_t>(value);
+  }
+
+  uint16_t GetAsUInt16(const StringView& flag) const {
+    uint64_t value;
+    if (!this->GetAsUInt64(flag, value)) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " was not specified");
       else
         return 0;
     }
     if (value > std::numeric_limits<uint16_t>::max()) {
       if (_exceptions_enabled)
-        throw SargsError(flag + " was too large for uint16_t");
+        throw SargsError(std::string(flag) + " was too large for uint16_t");
       else
         return 0;
     }
     return static_cast<uint16_t>(value);
   }
 
-  uint8_t GetAsUInt8(const std::string& flag) const {
-    uint64_t value;
-    if (!this->GetAsUInt64(flag, value)) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " was not specified");
-      else
-        return 0;
-    }
-    if (value > std::numeric_limits<uint8_t>::max()) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " was too large for uint8_t");
-      else
-        return 0;
-    }
-    return static_cast<uint8_t>(value);
+  uint8_t GetAsUInt8(const StringView& flag) const {
+    uint64_t value;
+    if (!this->GetAsUInt64(flag, value)) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " was not specified");
+      else
+        return 0;
+    }
+    if (value > std::numeric_limits<uint8_t>::max()) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " was too large for uint8_t");
+      else
+        return 0;
+    }
+    return static_cast<uint8_t>(value);
+  }
+
+  bool GetAsInt64(const StringView& flag, int64_t& value) const {
+    if (flag.empty()) {
+      if (_exceptions_enabled)
+        throw SargsError("Flag query empty");
+      else
+        return false;
+    }
+
+    const StringView* found = this->Find(flag);
+    if (found == nullptr)
+      return false;
+    SARGS_STATS(++_stats.integer_conversions;)
+
+    int64_t myvalue = 0;
+    if (!ConvertNumber(found->data(), found->size(), myvalue)) {
+      if (_exceptions_enabled)
+        throw SargsError("Could not convert " + std::string(*found) + " to int64_t");
+      else
+        return false;
+    }
+
+    value = myvalue;
+    return true;
+  }
+
+  int64_t GetAsInt64(const StringView& flag) const {
+    int64_t value;
+    if (!this->GetAsInt64(flag, value)) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " was not specified");
+      else
+        return 0;
+    }
+    return value;
+  }
+
+  int32_t GetAsInt32(const StringView& flag) const {
+    int64_t value;
+    if (!this->GetAsInt64(flag, value)) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " was not specified");
+      else
+        return 0;
+    }
+    if (value > std::numeric_limits<int32_t>::max()) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " is too large to convert to int32_t: " + std::to_string(value));
+      else
+        return 0;
+    } else if (value < std::numeric_limits<int32_t>::min()) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " was too low to convert to int32_t" + std::to_string(value));
+      else
+        return 0;
+    }
+    return static_cast<int32_t>(value);
+  }
+
+  int16_t GetAsInt16(const StringView& flag) const {
+    int64_t value;
+    if (!this->GetAsInt64(flag, value)) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " was not specified");
+      else
+        return 0;
+    }
+    if (value > std::numeric_limits<int16_t>::max()) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " is too large to convert to int16_t: " + std::to_string(value));
+      else
+        return 0;
+    } else if (value < std::numeric_limits<int16_t>::min()) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " is too small to convert to int16_t: " + std::to_string(value));
+      else
+        return 0;
+    }
+    return static_cast<int16_t>(value);
+  }
+
+  int32_t GetAsInt8(const StringView& flag) const {
+    int64_t value;
+    if (!this->GetAsInt64(flag, value)) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " was not specified");
+      else
+        return 0;
+    }
+    if (value > std::numeric_limits<int8_t>::max()) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " is too large to convert to int8_t: " + std::to_string(value));
+      else
+        return 0;
+    } else if (value < std::numeric_limits<int8_t>::min()) {
+      if (_exceptions_enabled)
+        throw SargsError(std::string(flag) + " is too small to convert to int8_t: " + std::to_string(value));
+      else
+        return 0;
+    }
+    return static_cast<int8_t>(value);
+  }
+
+  // Either name of a flag may be used. Presence is a single bit test once the id is known.
+  bool Has(const StringView& flag) const {
+    if (_schema == nullptr)
+      return false;
+    return this->IsPresent(this->FindId(flag));
+  }
+
+  bool Has(const FlagId id) const {
+    return this->IsPresent(id);
+  }
+
+  // Returns the value of a flag by id, which skips the name lookup. Empty if the flag was not set.
+  StringView GetValue(const FlagId id) const {
+    if (!this->IsPresent(id))
+      return StringView();
+    return _values[id];
+  }
+
+  // Returns every value of a repeated flag in the order given. Other flags, and repeated flags that
+  // only have their default, have at most one value.
+  ArrayView<StringView> GetAll(const FlagId id) const {
+    if (!this->IsPresent(id))
+      return ArrayView<StringView>();
+    if (id + 1 < _repeated_offsets.size()) {
+      const uint32_t begin = _repeated_offsets[id];
+      const uint32_t end = _repeated_offsets[id + 1];
+      if (begin != end)
+        return ArrayView<StringView>(_repeated_values.data() + begin, end - begin);
+    }
+    return ArrayView<StringView>(&_values[id], 1);
+  }
+
+  ArrayView<StringView> GetAll(const StringView& flag) const {
+    if (flag.empty()) {
+      if (_exceptions_enabled)
+        throw SargsError("Flag query empty");
+      else
+        return ArrayView<StringView>();
+    }
+    if (_schema == nullptr)
+      return ArrayView<StringView>();
+    return this->GetAll(this->FindId(flag));
+  }
+
+  // Converts a flag whose value is a separated list of numbers, such as --weights=1.5,2,3
+  bool GetAsFloatList(const StringView& flag, std::vector<float>& values, const char separator = ',') const {
+    return this->ConvertListValue(flag, separator, values, "float");
+  }
+
+  std::vector<float> GetAsFloatList(const StringView& flag, const char separator = ',') const {
+    std::vector<float> values;
+    this->GetAsFloatList(flag, values, separator);
+    return values;
+  }
+
+  bool GetAsInt64List(const StringView& flag, std::vector<int64_t>& values, const char separator = ',') const {
+    return this->ConvertListValue(flag, separator, values, "int64_t");
+  }
+
+  std::vector<int64_t> GetAsInt64List(const StringView& flag, const char separator = ',') const {
+    std::vector<int64_t> values;
+    this->GetAsInt64List(flag, values, separator);
+    return values;
+  }
+
+  bool GetAsUInt64List(const StringView& flag, std::vector<uint64_t>& values, const char separator = ',') const {
+    return this->ConvertListValue(flag, separator, values, "uint64_t");
+  }
+
+  std::vector<uint64_t> GetAsUInt64List(const StringView& flag, const char separator = ',') const {
+    std::vector<uint64_t> values;
+    this->GetAsUInt64List(flag, values, separator);
+    return values;
+  }
+
+  // Converts every value of a flag into values, replacing its contents
+  bool GetAllAsInt64(const StringView& flag, std::vector<int64_t>& values) const {
+    return this->ConvertAll(flag, values, "int64_t");
+  }
+
+  std::vector<int64_t> GetAllAsInt64(const StringView& flag) const {
+    std::vector<int64_t> values;
+    this->GetAllAsInt64(flag, values);
+    return values;
+  }
+
+  bool GetAllAsUInt64(const StringView& flag, std::vector<uint64_t>& values) const {
+    return this->ConvertAll(flag, values, "uint64_t");
+  }
+
+  std::vector<uint64_t> GetAllAsUInt64(const StringView& flag) const {
+    std::vector<uint64_t> values;
+    this->GetAllAsUInt64(flag, values);
+    return values;
+  }
+
+  bool GetAllAsFloat(const StringView& flag, std::vector<float>& values) const {
+    return this->ConvertAll(flag, values, "float");
+  }
+
+  std::vector<float> GetAllAsFloat(const StringView& flag) const {
+    std::vector<float> values;
+    this->GetAllAsFloat(flag, values);
+    return values;
+  }
+
+  // Returns the mapped contents of the file named by a binary flag as an array of T in native byte order.
+  // The file size must be a multiple of sizeof(T). The view stays valid as long as the result.
+  template <typename T>
+  bool GetAsArray(const StringView& flag, ArrayView<T>& values) const {
+    static_assert(std::is_arithmetic<T>::value, "Binary flag values must be arithmetic types");
+    if (flag.empty()) {
+      if (_exceptions_enabled)
+        throw SargsError("Flag query empty");
+      else
+        return false;
+    }
+
+    const StringView* found = this->Find(flag);
+    if (found == nullptr)
+      return false;
+    SARGS_STATS(++_stats.array_conversions;)
+
+    const FlagId id = this->FindId(flag);
+    std::string error;
+    if (id >= _binary_values.size() || _binary_values[id].data() == nullptr)
+      error = std::string(flag) + " is not a binary flag";
+    else if (_binary_values[id].size() % sizeof(T) != 0)
+      error = "Size of " + std::string(*found) + " is not a multiple of " + std::to_string(sizeof(T)) + " bytes";
+    else if (reinterpret_cast<uintptr_t>(_binary_values[id].data()) % alignof(T) != 0)
+      error = "Contents of " + std::string(*found) + " are not aligned for the requested type";
+
+    if (!error.empty()) {
+      if (_exceptions_enabled)
+        throw SargsError(error);
+      else
+        return false;
+    }
+
+    const ArrayView<char>& bytes = _binary_values[id];
+    values = ArrayView<T>(reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T));
+    return true;
+  }
+
+  template <typename T>
+  ArrayView<T> GetAsArray(const StringView& flag) const {
+    ArrayView<T> values;
+    this->GetAsArray(flag, values);
+    return values;
+  }
+
+  std::string GetNonFlag(const size_t index) const {
+    return _nonflags.at(index);
+  }
+
+  std::vector<std::string> GetNonFlags() const {
+    return std::vector<std::string>(_nonflags.begin(), _nonflags.end());
+  }
+
+  const NonFlagList& GetNonFlagViews() const {
+    return _nonflags;
+  }
+
+  // Counts non-flags whether they were stored or passed to a handler
+  size_t GetNonFlagCount() const {
+    return _nonflag_count;
+  }
+
+  // Parses into this result record spans to tracer, which must outlive the parses. Null turns tracing off.
+  void SetTracer(Tracer* tracer) {
+    _tracer = tracer;
+  }
+
+  Tracer* GetTracer() const {
+    return _tracer;
+  }
+
+  // All zero unless SARGS_ENABLE_STATS is defined
+  const ParseStats& GetStats() const {
+#if defined(SARGS_ENABLE_STATS)
+    return _stats;
+#else
+    static const ParseStats kNoStats;
+    return kNoStats;
+#endif
+  }
+
+  std::string FindAlternative(const StringView& flag) const;
+
+  std::string GetBinary() const {
+    return _binary;
+  }
+
+  // Empty if parsing succeeded, otherwise the reason it failed
+  const std::string& GetError() const {
+#if defined(SARGS_FIXED_CAPACITY)
+    // Only written out when asked for, so a parse never allocates for it
+    if (_error.empty() && _error_code != ErrorCode::kNone)
+      _error = this->FormatError();
+#endif
+    return _error;
+  }
+
+  ErrorCode GetErrorCode() const {
+    return _error_code;
+  }
+
+  // The argument, flag or file the error is about, empty if it is not about one
+  StringView GetErrorSubject() const {
+    return _error_subject;
+  }
+
+  // Writes the text of GetError() to output without building it up first, so it reads the subject
+  // through the same view as GetErrorSubject()
+  void WriteError(std::ostream& output) const;
+
+  bool ExceptionsEnabled() const {
+    return _exceptions_enabled;
+  }
+
+  // Sizes the containers for parses of up to tokens arguments with flags registered, so they never grow
+  void Reserve(const size_t flags, const size_t tokens) {
+    _values.reserve(flags);
+    _present.reserve((flags + 63) / 64);
+    _repeated_offsets.reserve(flags + 1);
+    _repeated_pending.reserve(tokens);
+    _repeated_values.reserve(tokens);
+    _nonflags.reserve(tokens);
+  }
+
+  // Bytes Reserve() takes from an arena
+  static constexpr size_t ReservedBytes(const size_t flags, const size_t tokens) {
+    return sargs::ReservedBytes<StringView>(flags) + sargs::ReservedBytes<uint64_t>((flags + 63) / 64) +
+           sargs::ReservedBytes<uint32_t>(flags + 1) +
+           sargs::ReservedBytes<std::pair<FlagId, StringView>>(tokens) +
+           sargs::ReservedBytes<StringView>(tokens) * 2;
+  }
+
+  // Forgets everything that was parsed while keeping the memory for the next parse
+  void Clear() {
+    std::fill(_present.begin(), _present.end(), 0);
+    _nonflags.clear();
+    _nonflag_count = 0;
+    _repeated_pending.clear();
+    _repeated_values.clear();
+    _repeated_offsets.clear();
+    _storage.clear();
+    _binary = StringView();
+    this->ClearError();
+    _tokens.clear();
+    _mapped_files.clear();
+    _binary_values.clear();
+    SARGS_STATS(_stats = ParseStats();)
+  }
+
+ private:
+  friend class Schema;
+  friend class Args;
+
+  const Schema* _schema = nullptr;
+  // One value per registered flag, indexed by the id the schema gave it
+  Vector<StringView> _values;
+  // One bit per flag id, set when the flag was specified or given a fallback
+  Vector<uint64_t> _present;
+  NonFlagList _nonflags;
+  size_t _nonflag_count = 0;
+  // Values of repeated flags in the order given, then grouped by id once parsing is done so each flag's
+  // values are contiguous in _repeated_values starting at _repeated_offsets[id]
+  Vector<std::pair<FlagId, StringView>> _repeated_pending;
+  Vector<StringView> _repeated_values;
+  Vector<uint32_t> _repeated_offsets;
+  Vector<char> _storage;
+  // argv[0], kept like any other argument
+  StringView _binary;
+  ErrorCode _error_code = ErrorCode::kNone;
+  StringView _error_subject;
+  // The flag a binary file was named by
+  StringView _error_flag;
+  // Written when parsing fails, or on the first GetError() in a fixed capacity build
+  mutable std::string _error;
+  // argv with any response files expanded, only filled when a response file was given
+  Vector<StringView> _tokens;
+  // Response files and the files named by binary flags
+  std::vector<std::unique_ptr<MappedFile>> _mapped_files;
+  // Contents of the file named by each binary flag, indexed by id. Empty unless the schema has one.
+  Vector<ArrayView<char>> _binary_values;
+  // How each token reads, filled by the threads of a parallel parse and kept for the next one
+  Vector<TokenClass> _classes;
+  bool _argv_views = false;
+  bool _exceptions_enabled = true;
+  Tracer* _tracer = nullptr;
+#if defined(SARGS_ENABLE_STATS)
+  // Getters are const but still count what they do
+  mutable ParseStats _stats;
+#endif
+
+  // Where lookups on behalf of this result are counted, or null when statistics are compiled out
+  ParseStats* Stats() const {
+#if defined(SARGS_ENABLE_STATS)
+    return &_stats;
+#else
+    return nullptr;
+#endif
+  }
+
+  // Appends to one of the growing containers, counting each time it has to reallocate
+  template <typename Container>
+  void Append(Container& values, const typename Container::value_type& value) {
+    SARGS_STATS(const size_t capacity = values.capacity();)
+    values.push_back(value);
+    SARGS_STATS(_stats.allocations += (values.capacity() != capacity) ? 1 : 0;)
+  }
+
+  // The capacity of the containers that are sized once per parse, in elements and in bytes
+  void MeasureCapacity(size_t* capacities, uint64_t& bytes) const {
+    capacities[0] = _values.capacity();
+    capacities[1] = _present.capacity();
+    capacities[2] = _storage.capacity();
+    capacities[3] = _repeated_values.capacity();
+    capacities[4] = _repeated_offsets.capacity();
+    capacities[5] = _binary_values.capacity();
+    bytes = _values.capacity() * sizeof(StringView) + _present.capacity() * sizeof(uint64_t) +
+            _storage.capacity() + _repeated_values.capacity() * sizeof(StringView) +
+            _repeated_offsets.capacity() * sizeof(uint32_t) + _binary_values.capacity() * sizeof(ArrayView<char>) +
+            _nonflags.capacity() * sizeof(StringView) + _tokens.capacity() * sizeof(StringView) +
+            _repeated_pending.capacity() * sizeof(std::pair<FlagId, StringView>);
+  }
+
+  // Returns a view of data that stays valid as long as the result. Only argv and response file tokens
+  // may be referenced in place; everything else is copied into _storage, which was reserved up front
+  // so it never moves. Either way the view is followed by a NUL, so values can be handed to C
+  // conversion functions.
+  StringView Keep(const char* data, const size_t size, const bool from_argv = false) {
+    if (from_argv && _argv_views)
+      return StringView(data, size);
+    const size_t offset = _storage.size();
+    _storage.insert(_storage.end(), data, data + size);
+    _storage.push_back('\0');
+    return StringView(_storage.data() + offset, size);
+  }
+
+  // Records why parsing failed and returns code. Outside a fixed capacity build the message is written
+  // straight away, while subject is sure to be valid.
+  ErrorCode Fail(const ErrorCode code, const StringView& subject = StringView(),
+                 const StringView& flag = StringView()) {
+    _error_code = code;
+    _error_subject = subject;
+    _error_flag = flag;
+#if !defined(SARGS_FIXED_CAPACITY)
+    _error = this->FormatError();
+#endif
+    return code;
+  }
+
+  void ClearError() {
+    _error_code = ErrorCode::kNone;
+    _error_subject = StringView();
+    _error_flag = StringView();
+    _error.clear();
+  }
+
+  std::string FormatError() const;
+
+  void Set(const FlagId id, const StringView& value) {
+    _values[id] = value;
+    _present[id >> 6] |= uint64_t(1) << (id & 63);
+  }
+
+  // Sorts the pending repeated values by flag id, keeping the order each flag's values were given in
+  void GroupRepeatedValues(const size_t flag_count) {
+    _repeated_offsets.assign(flag_count + 1, 0);
+    for (const auto& pending : _repeated_pending)
+      ++_repeated_offsets[pending.first + 1];
+    for (size_t id = 0; id < flag_count; ++id)
+      _repeated_offsets[id + 1] += _repeated_offsets[id];
+
+    _repeated_values.resize(_repeated_pending.size());
+    for (const auto& pending : _repeated_pending)
+      _repeated_values[_repeated_offsets[pending.first]++] = pending.second;
+    for (size_t id = flag_count; id > 0; --id)
+      _repeated_offsets[id] = _repeated_offsets[id - 1];
+    _repeated_offsets[0] = 0;
+  }
+
+  template <typename T>
+  bool ConvertListValue(const StringView& flag, const char separator, std::vector<T>& values,
+                        const char* type_name) const {
+    if (flag.empty()) {
+      if (_exceptions_enabled)
+        throw SargsError("Flag query empty");
+      else
+        return false;
+    }
+
+    values.clear();
+    const StringView* found = this->Find(flag);
+    if (found == nullptr)
+      return false;
+    SARGS_STATS(++_stats.list_conversions;)
+
+    size_t error_offset = 0;
+    if (!ConvertList(found->data(), found->size(), separator, values, error_offset)) {
+      if (_exceptions_enabled) {
+        const char* element = found->data() + error_offset;
+        const char* element_end = std::find(element, found->end(), separator);
+        throw SargsError("Could not convert \"" + std::string(element, element_end) + "\" at offset " +
+                         std::to_string(error_offset) + " of " + std::string(flag) + " to " + type_name);
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  template <typename T>
+  bool ConvertAll(const StringView& flag, std::vector<T>& values, const char* type_name) const {
+    const ArrayView<StringView> all = this->GetAll(flag);
+    SARGS_STATS(_stats.list_conversions += all.empty() ? 0 : 1;)
+    values.resize(all.size());
+    for (size_t i = 0; i < all.size(); ++i) {
+      if (!ConvertNumber(all[i].data(), all[i].size(), values[i])) {
+        values.clear();
+        if (_exceptions_enabled)
+          throw SargsError("Could not convert " + std::string(all[i]) + " to " + type_name);
+        else
+          return false;
+      }
+    }
+    return !all.empty();
+  }
+
+  bool IsPresent(const FlagId id) const {
+    const size_t word = id >> 6;
+    return word < _present.size() && ((_present[word] >> (id & 63)) & 1) != 0;
+  }
+
+  FlagId FindId(const StringView& flag) const;
+
+  const StringView* Find(const StringView& flag) const;
+};
+
+// The flags a program accepts. Once Compile() has been called the schema is read-only and Parse() may
+// be called from any number of threads at once, each producing its own ParseResult.
+class Schema {
+ public:
+  Schema() = default;
+
+  // Takes all of its memory from arena, which must outlive the schema
+  explicit Schema(Arena* arena) :
+    _arena(arena), _flags(arena), _required(arena), _optional(arena), _index(arena), _short_ids(arena) {}
+
+  // Arguments refer to strings owned by the schema, and results to the schema itself
+  Schema(const Schema&) = delete;
+  Schema& operator=(const Schema&) = delete;
+  Schema(Schema&&) = default;
+  Schema& operator=(Schema&&) = default;
+
+  FlagId AddRequiredFlag(const StringView& flag, const StringView& alias, const StringView& description) {
+    return this->Register(Argument(flag, alias, description, false), true);
+  }
+
+  FlagId AddRequiredFlagValue(const StringView& flag, const StringView& alias, const StringView& description,
+                              const StringView& fallback = StringView()) {
+    return this->Register(Argument(flag, alias, description, true, fallback), true);
+  }
+
+  FlagId AddOptionalFlag(const StringView& flag, const StringView& alias, const StringView& description) {
+    return this->Register(Argument(flag, alias, description, false), false);
+  }
+
+  // A value flag that may be given any number of times. Every value is kept; see ParseResult::GetAll().
+  FlagId AddRequiredRepeatedFlagValue(const StringView& flag, const StringView& alias,
+                                      const StringView& description) {
+    Argument argument(flag, alias, description, true);
+    argument.repeated = true;
+    return this->Register(argument, true);
+  }
+
+  FlagId AddOptionalRepeatedFlagValue(const StringView& flag, const StringView& alias,
+                                      const StringView& description) {
+    Argument argument(flag, alias, description, true);
+    argument.repeated = true;
+    return this->Register(argument, false);
+  }
+
+#if !defined(SARGS_FIXED_CAPACITY)
+  // A value flag naming a file of raw binary values, such as --ids=@ids.u64. The file is mapped
+  // read-only while parsing; see ParseResult::GetAsArray().
+  FlagId AddRequiredBinaryFlagValue(const StringView& flag, const StringView& alias,
+                                    const StringView& description) {
+    Argument argument(flag, alias, description, true);
+    argument.binary = true;
+    return this->Register(argument, true);
+  }
+
+  FlagId AddOptionalBinaryFlagValue(const StringView& flag, const StringView& alias,
+                                    const StringView& description) {
+    Argument argument(flag, alias, description, true);
+    argument.binary = true;
+    return this->Register(argument, false);
+  }
+#endif
+
+  // Reserves room for this many repeated values in each result, so the first parse does not grow it
+  void ReserveRepeatedValues(const size_t count) {
+    _repeated_reserve = count;
+  }
+
+  // Sizes the registry for this many flags, so registering and compiling them never grows it
+  void Reserve(const size_t flags) {
+    _flags.reserve(flags);
+    _required.reserve(flags);
+    _optional.reserve(flags);
+    _index.Reserve(flags * 2);
+    _short_ids.reserve(256);
+  }
+
+  // Bytes Reserve() takes from an arena
+  static constexpr size_t ReservedBytes(const size_t flags) {
+    return sargs::ReservedBytes<Argument>(flags) + sargs::ReservedBytes<FlagId>(flags) * 2 +
+           FlagIndex::ReservedBytes(flags * 2) + sargs::ReservedBytes<FlagId>(256);
+  }
+
+  FlagId AddOptionalFlagValue(const StringView& flag, const StringView& alias, const StringView& description,
+                              const StringView& fallback = StringView()) {
+    return this->Register(Argument(flag, alias, description, true, fallback), false);
+  }
+
+  void RequireNonFlags(const int count) {
+    _nonflags_required = count;
+  }
+
+  // Passes non-flags to handler as they are parsed instead of storing them, so any number of them can be
+  // consumed without holding them all in memory. Any count is accepted unless RequireNonFlags() is set.
+  void SetNonFlagHandler(const NonFlagHandler& handler) {
+    _nonflag_handler = handler;
+  }
+
+  void DisableExceptions() {
+    _exceptions_enabled = false;
+  }
+
+  // Keep values and non-flags as views into argv instead of copying them. argv must outlive the result.
+  void EnableArgvViews() {
+    _argv_views = true;
+  }
+
+#if !defined(SARGS_FIXED_CAPACITY)
+  // Replace each @file token with the tokens in that file, as gcc does. Tokens after "--" are left alone.
+  void EnableResponseFiles() {
+    _response_files = true;
+  }
+
+  // Parses arguments of at least min_tokens on threads threads, or one per core if threads is 0. The
+  // tokens are classified in chunks, one per thread, then applied in order on the calling thread so the
+  // result is the same as parsing on one thread; non-flags are then copied in parallel. Each parallel
+  // parse starts its threads and allocates, unlike a reparse on one thread.
+  void EnableParallelParse(const size_t threads = 0, const size_t min_tokens = kParallelMinTokens) {
+    _parallel_threads = (threads != 0) ? threads : std::max<size_t>(1, std::thread::hardware_concurrency());
+    _parallel_min_tokens = min_tokens;
+  }
+#endif
+
+  const Vector<FlagId>& GetRequired() const {
+    return _required;
+  }
+
+  const Vector<FlagId>& GetOptional() const {
+    return _optional;
+  }
+
+  size_t GetNonFlagsRequired() const {
+    return _nonflags_required;
+  }
+
+  bool ExceptionsEnabled() const {
+    return _exceptions_enabled;
+  }
+
+  std::string FindAlternative(const StringView& flag) const {
+    const FlagId id = this->FindId(flag.data(), flag.size());
+    if (id == kUnknownFlag)
+      return "";
+    const Argument& argument = this->GetArgument(id);
+    return (argument.flag == flag) ? argument.alias : argument.flag;
+  }
+
+  // Returns the id shared by a flag and its alias, or kUnknownFlag
+  FlagId FindId(const char* name, const size_t size) const {
+    return this->FindId(name, size, FlagIndex::Hash(name, size));
+  }
+
+  FlagId FindId(const StringView& name) const {
+    return this->FindId(name.data(), name.size());
+  }
+
+  // As above, counting the lookup in stats if statistics are enabled
+  FlagId FindId(const StringView& name, ParseStats* stats) const {
+    return this->FindId(name.data(), name.size(), FlagIndex::Hash(name.data(), name.size()), stats);
+  }
+
+  const Argument& GetArgument(const FlagId id) const {
+    return _flags[id];
+  }
+
+  size_t GetFlagCount() const {
+    return _flags.size();
+  }
+
+  // Builds the lookup index. Must be called again after registering more flags.
+  void Compile() {
+    const FlagId total = static_cast<FlagId>(_flags.size());
+    _index.Reset(total * 2);
+    _short_ids.clear();
+    _first_bytes.Clear();
+    _second_bytes.Clear();
+    for (FlagId id = 0; id < total; ++id) {
+      const Argument& argument = this->GetArgument(id);
+      this->IndexName(argument.flag, id);
+      this->IndexName(argument.alias, id);
+      this->IndexShortName(argument.flag, id);
+      this->IndexShortName(argument.alias, id);
+      this->IndexLeadingBytes(argument.flag);
+      this->IndexLeadingBytes(argument.alias);
+    }
+    _compiled = true;
+  }
+
+  bool IsCompiled() const {
+    return _compiled;
+  }
+
+  // Parses into an existing result, replacing whatever it held before
+  void Parse(int argc, char* argv[], ParseResult& result) const {
+    if (!_compiled)
+      throw SargsError("Schema must be compiled before parsing");
+
+    SARGS_STATS(
+      result._stats = ParseStats();
+      size_t capacities[6];
+      uint64_t retained_bytes = 0;
+      result.MeasureCapacity(capacities, retained_bytes);
+      StatsTimer timer(result._stats.parse_ns);
+    )
+    TraceSpan parse_span(result._tracer, "Parse");
+    result._schema = this;
+    result._argv_views = _argv_views;
+    result._exceptions_enabled = _exceptions_enabled;
+    result._values.resize(this->GetFlagCount());
+    result._present.assign((this->GetFlagCount() + 63) / 64, 0);
+    result._nonflags.clear();
+    result._nonflag_count = 0;
+    result._repeated_pending.clear();
+    result._repeated_pending.reserve(_repeated_reserve);
+    result._repeated_values.reserve(_repeated_reserve);
+    result._repeated_offsets.clear();
+    result._tokens.clear();
+    result._mapped_files.clear();
+    result._binary_values.clear();
+    result.ClearError();
+
+    const ArgvTokens arguments = {argc, argv};
+    // Replaced by a kept copy once storage is reserved, unless a response file cannot be read first
+    result._binary = arguments[0];
+    if (_registration_error != ErrorCode::kNone) {
+      result.Fail(_registration_error);
+      return;
+    }
+#if defined(SARGS_FIXED_CAPACITY)
+    if (static_cast<size_t>(argc) > SARGS_MAX_ARGS) {
+      result.Fail(ErrorCode::kTooManyArguments);
+      return;
+    }
+#endif
+
+    ErrorCode error = ErrorCode::kNone;
+    if (!_response_files || !HasResponseFile(arguments)) {
+      this->ReserveStorage(arguments, result);
+      error = this->ParseTokens(arguments, result);
+    } else {
+      {
+        TraceSpan span(result._tracer, "ExpandResponseFiles");
+        error = this->ExpandResponseFiles(arguments, result);
+      }
+      if (error != ErrorCode::kNone)
+        return;
+      this->ReserveStorage(result._tokens, result);
+      error = this->ParseTokens(result._tokens, result);
+    }
+    if (_repeated_count > 0) {
+      TraceSpan span(result._tracer, "GroupRepeatedValues");
+      result.GroupRepeatedValues(this->GetFlagCount());
+    }
+    this->AddFallbackValues(result);
+    if (_binary_count > 0 && error == ErrorCode::kNone) {
+      TraceSpan span(result._tracer, "MapBinaryValues");
+      this->MapBinaryValues(result);
+    }
+
+    SARGS_STATS(
+      size_t parsed_capacities[6];
+      result.MeasureCapacity(parsed_capacities, result._stats.retained_bytes);
+      for (int i = 0; i < 6; ++i)
+        result._stats.allocations += (parsed_capacities[i] != capacities[i]) ? 1 : 0;
+      result._stats.storage_bytes = result._storage.capacity();
+    )
+  }
+
+  ParseResult Parse(int argc, char* argv[]) const {
+    ParseResult result;
+    this->Parse(argc, argv, result);
+    return result;
+  }
+
+ private:
+  // Where the schema's memory comes from, the heap if null. Names and descriptions are copied into
+  // _strings then, so they are kept together rather than each in its own allocation.
+  Arena* _arena = nullptr;
+  Arena _strings;
+  Vector<Argument> _flags;
+  Vector<FlagId> _required;
+  Vector<FlagId> _optional;
+  FlagIndex _index;
+  // Flags with a one character name like -v, indexed by that character, so -abc can be read as -a -b -c.
+  // Empty if there are none.
+  Vector<FlagId> _short_ids;
+  // The first and second bytes of every name. An argument starting with anything else cannot be a
+  // flag, which rules out paths and most other non-flags before they are hashed.
+  ByteSet _first_bytes;
+  ByteSet _second_bytes;
+  NonFlagHandler _nonflag_handler;
+  // Set when a flag could not be registered, and reported by every parse
+  ErrorCode _registration_error = ErrorCode::kNone;
+  size_t _repeated_count = 0;
+  size_t _repeated_reserve = 0;
+  size_t _binary_count = 0;
+  size_t _nonflags_required = 0;
+#if defined(SARGS_FIXED_CAPACITY)
+  bool _exceptions_enabled = false;
+  bool _argv_views = true;
+#else
+  bool _exceptions_enabled = true;
+  bool _argv_views = false;
+#endif
+  bool _response_files = false;
+  bool _compiled = false;
+  // Zero unless EnableParallelParse() was called
+  size_t _parallel_threads = 0;
+  size_t _parallel_min_tokens = 0;
+
+  // Limits how deeply response files may name other response files, which also stops cycles
+  static const int kMaxResponseFileDepth = 16;
+
+  // Below this many tokens starting threads costs more than it saves
+  static const size_t kParallelMinTokens = 1 << 16;
+
+  static bool NameEquals(const StringView& name, const char* data, const size_t size) {
+    return !name.empty() && name.size() == size && std::memcmp(name.data(), data, size) == 0;
+  }
+
+  FlagId Register(const Argument& argument, const bool required) {
+#if defined(SARGS_FIXED_CAPACITY)
+    if (_flags.size() == SARGS_MAX_FLAGS) {
+      _registration_error = ErrorCode::kTooManyFlags;
+      return kUnknownFlag;
+    }
+#endif
+    const FlagId id = static_cast<FlagId>(_flags.size());
+    _flags.push_back(argument);
+    Argument& registered = _flags.back();
+    registered.required = required;
+    registered.flag = this->CopyString(argument.flag);
+    registered.alias = this->CopyString(argument.alias);
+    registered.description = this->CopyString(argument.description);
+    registered.fallback = this->CopyString(argument.fallback);
+    if (argument.repeated)
+      ++_repeated_count;
+    if (argument.binary)
+      ++_binary_count;
+    if (required)
+      _required.push_back(id);
+    else
+      _optional.push_back(id);
+    _compiled = false;
+    return id;
+  }
+
+  // Copies text into the schema's arena, NUL terminated like argv so values can be kept in place
+  StringView CopyString(const StringView& text) {
+    if (text.empty())
+      return StringView("", 0);
+    Arena& arena = (_arena != nullptr) ? *_arena : _strings;
+    char* copy = static_cast<char*>(arena.Allocate(text.size() + 1, 1));
+    if (copy == nullptr) {
+      _registration_error = ErrorCode::kOutOfSpace;
+      return StringView("", 0);
+    }
+    std::memcpy(copy, text.data(), text.size());
+    copy[text.size()] = '\0';
+    return StringView(copy, text.size());
+  }
+
+  void IndexName(const StringView& name, const FlagId id) {
+    if (name.empty())
+      return;
+
+    // The first registration of a name wins, matching the order flags are checked in
+    const uint64_t hash = FlagIndex::Hash(name.data(), name.size());
+    if (this->FindId(name.data(), name.size(), hash) != kUnknownFlag)
+      return;
+    _index.Insert(hash, id);
+  }
+
+  void IndexLeadingBytes(const StringView& name) {
+    if (name.empty())
+      return;
+    _first_bytes.Insert(name[0]);
+    // A one byte name can only be followed by the '=' of name=value
+    _second_bytes.Insert(name.size() > 1 ? name[1] : '=');
+  }
+
+  // False if token cannot be a flag name, name=value or a group of one character names. Every one of
+  // those starts with the first two bytes of a name, since a group's second byte names its first flag.
+  bool MayBeFlag(const char* token, const size_t size) const {
+    return size > 0 && _first_bytes.Contains(token[0]) && (size == 1 || _second_bytes.Contains(token[1]));
+  }
+
+  void IndexShortName(const StringView& name, const FlagId id) {
+    if (name.size() != 2 || name[0] != '-' || name[1] == '-')
+      return;
+    if (_short_ids.empty())
+      _short_ids.assign(256, kUnknownFlag);
+    FlagId& slot = _short_ids[static_cast<unsigned char>(name[1])];
+    if (slot == kUnknownFlag)
+      slot = id;
+  }
+
+  FlagId FindId(const char* name, const size_t size, const uint64_t hash, ParseStats* stats = nullptr) const {
+    size_t probes = 0;
+    const FlagId id = _index.Find(hash, [&](const FlagId candidate) {
+      const Argument& argument = this->GetArgument(candidate);
+      return NameEquals(argument.flag, name, size) || NameEquals(argument.alias, name, size);
+    }, probes);
+    SARGS_STATS(
+      if (stats != nullptr) {
+        ++stats->lookups;
+        stats->probes += probes;
+      }
+    )
+    (void)stats;
+    return id;
+  }
+
+  // The name a flag is reported by, its alias if it was registered without a name
+  StringView GetName(const FlagId id) const {
+    const Argument& argument = this->GetArgument(id);
+    return argument.flag.empty() ? argument.alias : argument.flag;
+  }
+
+  ErrorCode CheckForMissing(ParseResult& result) const {
+    for (const FlagId id : _required) {
+      if (!result.IsPresent(id))
+        return result.Fail(ErrorCode::kMissingFlag, this->GetName(id));
+    }
+    return ErrorCode::kNone;
+  }
+
+  ErrorCode CheckForValues(ParseResult& result) const {
+    for (FlagId id = 0; id < this->GetFlagCount(); ++id) {
+      const Argument& iter = this->GetArgument(id);
+      if (iter.value && result.IsPresent(id) && result._values[id].empty())
+        return result.Fail(ErrorCode::kMissingFlagValue, this->GetName(id));
+    }
+    return ErrorCode::kNone;
+  }
+
+  // Looks up the name in name=value, returning its id only if it takes a value
+  FlagId FindSplitId(const char* arg, const size_t size, const FlagIndex::Scan& scan,
+                     ParseStats* stats = nullptr) const {
+    if (scan.separator == size)
+      return kUnknownFlag;
+    const FlagId id = this->FindId(arg, scan.separator, scan.name_hash, stats);
+    if (id == kUnknownFlag || !this->GetArgument(id).value)
+      return kUnknownFlag;
+    return id;
+  }
+
+  // Reads -abc as -a -b -c and -p2 as -p 2 using the one character names. Returns the offset after the
+  // last character naming a flag, or 0 if arg is not made of them. value_id is set to the flag taking the
+  // rest of arg as its value, or the next argument if nothing is left, and kUnknownFlag if there is none.
+  size_t ScanShortFlags(const char* arg, const size_t size, FlagId& value_id) const {
+    value_id = kUnknownFlag;
+    if (_short_ids.empty() || size < 2 || arg[0] != '-' || arg[1] == '-')
+      return 0;
+    for (size_t i = 1; i < size; ++i) {
+      const FlagId id = _short_ids[static_cast<unsigned char>(arg[i])];
+      if (id == kUnknownFlag)
+        return 0;
+      if (this->GetArgument(id).value) {
+        value_id = id;
+        return i + 1;
+      }
+    }
+    return size;
+  }
+
+  // The one character name of id ending in c, which may be its flag or its alias
+  StringView GetShortName(const FlagId id, const char c) const {
+    const Argument& argument = this->GetArgument(id);
+    return (argument.flag.size() == 2 && argument.flag[1] == c) ? argument.flag : argument.alias;
+  }
+
+  ErrorCode MapBinaryValues(ParseResult& result) const {
+    result._binary_values.resize(this->GetFlagCount());
+    for (FlagId id = 0; id < this->GetFlagCount(); ++id) {
+      const Argument& argument = this->GetArgument(id);
+      if (!argument.binary || !result.IsPresent(id))
+        continue;
+
+      // The @ is optional; it only marks the value as a file for whoever reads the command line. Values
+      // are NUL terminated, so the path can be opened in place.
+      const StringView& value = result._values[id];
+      const size_t skip = (value[0] == '@') ? 1 : 0;
+      const StringView path(value.data() + skip, value.size() - skip);
+      std::unique_ptr<MappedFile> file(new MappedFile());
+      if (!file->Open(path.data(), false))
+        return result.Fail(ErrorCode::kBinaryFile, path, this->GetName(id));
+      result._binary_values[id] = ArrayView<char>(file->data(), file->size());
+      result._mapped_files.push_back(std::move(file));
+    }
+    return ErrorCode::kNone;
+  }
+
+  void AddFallbackValues(ParseResult& result) const {
+    SARGS_STATS(StatsTimer timer(result._stats.fallback_ns);)
+    TraceSpan span(result._tracer, "AddFallbackValues");
+    for (FlagId id = 0; id < this->GetFlagCount(); ++id) {
+      const Argument& iter = this->GetArgument(id);
+      if (iter.fallback.empty() || result.IsPresent(id))
+        continue;
+      // The schema's copy is NUL terminated and outlives the result like the rest of the schema
+      result.Set(id, iter.fallback);
+    }
+  }
+
+  static bool IsResponseFile(const StringView& token) {
+    return token.size() > 1 && token[0] == '@';
+  }
+
+  static bool HasResponseFile(const ArgvTokens& arguments) {
+    for (int i = 1; i < arguments.argc; ++i) {
+      if (arguments.argv[i][0] == '@' && arguments.argv[i][1] != '\0')
+        return true;
+    }
+    return false;
+  }
+
+  // How far response file expansion has got. Nothing is expanded after "--", and the token after the name
+  // of a binary flag is its file, which may be marked with an @ of its own.
+  struct ExpandState {
+    bool expand = true;
+    bool binary_value_next = false;
+  };
+
+  // True if token is the name of a binary flag, so the next token is its file
+  bool TakesBinaryValue(const StringView& token) const {
+    if (_binary_count == 0 || !this->MayBeFlag(token.data(), token.size()))
+      return false;
+    const FlagId id = this->FindId(token.data(), token.size());
+    return id != kUnknownFlag && this->GetArgument(id).binary;
+  }
+
+  ErrorCode ExpandResponseFiles(const ArgvTokens& arguments, ParseResult& result) const {
+    ExpandState state;
+    result.Append(result._tokens, arguments[0]);
+    for (size_t i = 1; i < arguments.size(); ++i) {
+      const StringView token = arguments[i];
+      const ErrorCode error = this->AppendToken(token, state, 0, result);
+      if (error != ErrorCode::kNone)
+        return error;
+    }
+    return ErrorCode::kNone;
+  }
+
+  ErrorCode AppendToken(const StringView& token, ExpandState& state, const int depth, ParseResult& result) const {
+    if (state.binary_value_next) {
+      state.binary_value_next = false;
+      result.Append(result._tokens, token);
+      return ErrorCode::kNone;
+    }
+    if (!state.expand || !IsResponseFile(token)) {
+      if (token.size() == 2 && token[0] == '-' && token[1] == '-')
+        state.expand = false;
+      else if (state.expand)
+        state.binary_value_next = this->TakesBinaryValue(token);
+      result.Append(result._tokens, token);
+      return ErrorCode::kNone;
+    }
+
+    if (depth == kMaxResponseFileDepth)
+      return result.Fail(ErrorCode::kResponseFileDepth, token);
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    if (!file->Open(token.data() + 1))
+      return result.Fail(ErrorCode::kResponseFileRead, StringView(token.data() + 1, token.size() - 1));
+    result._mapped_files.push_back(std::move(file));
+
+    MappedFile& mapped = *result._mapped_files.back();
+    size_t offset = 0;
+    StringView inner;
+    while (mapped.NextToken(offset, inner)) {
+      const ErrorCode error = this->AppendToken(inner, state, depth + 1, result);
+      if (error != ErrorCode::kNone)
+        return error;
+    }
+    return ErrorCode::kNone;
+  }
+
+  // Sums the tokens that will be copied as values when non-flags go to a handler instead of storage
+  template <typename Tokens>
+  size_t ValueTokenSize(const Tokens& tokens) const {
+    size_t total = 0;
+    bool value_next = false;
+    for (size_t i = 1; i < tokens.size(); ++i) {
+      const StringView token = tokens[i];
+      if (value_next) {
+        total += token.size() + 1;
+        value_next = false;
+        continue;
+      }
+      if (token.size() == 2 && token[0] == '-' && token[1] == '-')
+        break;
+      if (!this->MayBeFlag(token.data(), token.size()))
+        continue;
+
+      const FlagIndex::Scan scan = FlagIndex::ScanArgument(token.data(), token.size());
+      const FlagId id = this->FindId(token.data(), token.size(), scan.hash);
+      FlagId value_id = kUnknownFlag;
+      if (id != kUnknownFlag) {
+        value_next = this->GetArgument(id).value;
+      } else if (this->FindSplitId(token.data(), token.size(), scan) != kUnknownFlag) {
+        total += token.size() - scan.separator;
+      } else {
+        const size_t end = this->ScanShortFlags(token.data(), token.size(), value_id);
+        if (value_id != kUnknownFlag && end < token.size())
+          total += token.size() - end + 1;
+        else if (value_id != kUnknownFlag)
+          value_next = true;
+      }
+    }
+    return total;
+  }
+
+  template <typename Tokens>
+  void ReserveStorage(const Tokens& tokens, ParseResult& result) const {
+    TraceSpan span(result._tracer, "ReserveStorage");
+    size_t total = 0;
+    if (!_argv_views && _nonflag_handler) {
+      total += tokens[0].size() + 1 + this->ValueTokenSize(tokens);
+    } else if (!_argv_views) {
+      for (size_t i = 0; i < tokens.size(); ++i)
+        total += tokens[i].size() + 1;
+    }
+
+    result._storage.clear();
+    result._storage.reserve(total);
+    result._binary = result.Keep(tokens[0].data(), tokens[0].size(), true);
+  }
+
+  void SetValue(const FlagId id, const StringView& value, ParseResult& result) const {
+    result.Set(id, value);
+    if (this->GetArgument(id).repeated)
+      result.Append(result._repeated_pending, std::make_pair(id, value));
+  }
+
+  // With defer_copy the non-flag is stored as a view of the token and CopyNonFlags() copies it later
+  void AddNonFlag(const char* data, const size_t size, ParseResult& result, const bool defer_copy = false) const {
+    ++result._nonflag_count;
+    if (_nonflag_handler)
+      _nonflag_handler(StringView(data, size));
+    else if (defer_copy)
+      result.Append(result._nonflags, StringView(data, size));
+    else
+      result.Append(result._nonflags, result.Keep(data, size, true));
+  }
+
+  TokenClass Classify(const StringView& token, ParseStats* stats) const {
+    const char* current = token.data();
+    const size_t size = token.size();
+    TokenClass token_class = { TokenClass::kNonFlag, kUnknownFlag, 0 };
+    if (!this->MayBeFlag(current, size))
+      return token_class;
+    const FlagIndex::Scan scan = FlagIndex::ScanArgument(current, size);
+    token_class.id = this->FindId(current, size, scan.hash, stats);
+    if (token_class.id != kUnknownFlag) {
+      token_class.kind = TokenClass::kFlag;
+      return token_class;
+    }
+
+    token_class.id = this->FindSplitId(current, size, scan, stats);
+    if (token_class.id != kUnknownFlag) {
+      token_class.kind = TokenClass::kSplit;
+      token_class.offset = scan.separator;
+      return token_class;
+    }
+
+    token_class.offset = this->ScanShortFlags(current, size, token_class.id);
+    if (token_class.offset > 0)
+      token_class.kind = TokenClass::kShortGroup;
+    return token_class;
+  }
+
+  // Calls work(begin, end, chunk) for each of up to threads chunks of [0, count), the first on this thread
+  template <typename Work>
+  static void RunChunks(const size_t count, const size_t threads, Work work) {
+    const size_t chunk = (count + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t index = 1; index < threads && index * chunk < count; ++index)
+      workers.emplace_back(work, index * chunk, std::min(count, (index + 1) * chunk), index);
+    work(0, std::min(count, chunk), 0);
+    for (std::thread& worker : workers)
+      worker.join();
+  }
+
+  template <typename Tokens>
+  void ClassifyParallel(const Tokens& tokens, ParseResult& result) const {
+    TraceSpan span(result._tracer, "ClassifyTokens");
+    result._classes.resize(tokens.size());
+    std::vector<ParseStats> stats(_parallel_threads);
+    RunChunks(tokens.size(), _parallel_threads, [&](const size_t begin, const size_t end, const size_t index) {
+      for (size_t i = begin; i < end; ++i)
+        result._classes[i] = this->Classify(tokens[i], &stats[index]);
+    });
+    SARGS_STATS(
+      for (const ParseStats& chunk_stats : stats) {
+        result._stats.lookups += chunk_stats.lookups;
+        result._stats.probes += chunk_stats.probes;
+      }
+    )
+  }
+
+  // Copies the non-flags stored as views by a parallel parse into storage, each thread taking a chunk.
+  // Storage was reserved for every token so it does not move.
+  void CopyNonFlags(ParseResult& result) const {
+    TraceSpan span(result._tracer, "CopyNonFlags");
+    NonFlagList& nonflags = result._nonflags;
+    std::vector<size_t> offsets(_parallel_threads + 1, 0);
+    RunChunks(nonflags.size(), _parallel_threads, [&](const size_t begin, const size_t end, const size_t index) {
+      for (size_t i = begin; i < end; ++i)
+        offsets[index + 1] += nonflags[i].size() + 1;
+    });
+    for (size_t index = 0; index < _parallel_threads; ++index)
+      offsets[index + 1] += offsets[index];
+
+    const size_t base = result._storage.size();
+    result._storage.resize(base + offsets[_parallel_threads]);
+    char* storage = result._storage.data() + base;
+    RunChunks(nonflags.size(), _parallel_threads, [&](const size_t begin, const size_t end, const size_t index) {
+      char* output = storage + offsets[index];
+      for (size_t i = begin; i < end; ++i) {
+        const size_t size = nonflags[i].size();
+        std::memcpy(output, nonflags[i].data(), size);
+        output[size] = '\0';
+        nonflags[i] = StringView(output, size);
+        output += size + 1;
+      }
+    });
+  }
+
+  // Tokens is argv itself or argv with its response files expanded; token 0 is the binary
+  template <typename Tokens>
+  ErrorCode ParseTokens(const Tokens& tokens, ParseResult& result) const {
+    if (_parallel_threads <= 1 || tokens.size() < _parallel_min_tokens) {
+      return this->ApplyTokens(tokens, result, [&](const size_t, const StringView& token) {
+        return this->Classify(token, result.Stats());
+      }, false);
+    }
+
+    this->ClassifyParallel(tokens, result);
+    const bool defer_copy = !_argv_views && !_nonflag_handler;
+    if (defer_copy)
+      result._nonflags.reserve(tokens.size());
+    const ErrorCode error = this->ApplyTokens(tokens, result, [&](const size_t i, const StringView&) {
+      return result._classes[i];
+    }, defer_copy);
+    if (defer_copy)
+      this->CopyNonFlags(result);
+    return error;
+  }
+
+  // Walks the tokens in order, getting how each reads from classify(index, token)
+  template <typename Tokens, typename Classifier>
+  ErrorCode ApplyTokens(const Tokens& tokens, ParseResult& result, Classifier classify,
+                          const bool defer_copy) const {
+    // Once as many flags as are registered have been seen the rest are taken as non-flags. That does not
+    // hold when a flag may be repeated.
+    const int total_flags =
+        (_repeated_count > 0) ? std::numeric_limits<int>::max() : static_cast<int>(_flags.size());
+    int flags_encountered = 0;
+    bool delim_encountered = false;
+    TraceSpan span(result._tracer, "ParseTokens");
+    TokenTrace token_trace(result._tracer);
+    for (size_t i = 1; i < tokens.size(); ++i) {
+      // Check if we encountered the non-flag delimiter
+      const StringView token = tokens[i];
+      token_trace.Next(token, i);
+      const char* current = token.data();
+      const size_t size = token.size();
+      if (size == 2 && current[0] == '-' && current[1] == '-') {
+        delim_encountered = true;
+        continue;
+      }
+
+      // Check for explicit non-flags
+      if (delim_encountered) {
+        this->AddNonFlag(current, size, result, defer_copy);
+        continue;
+      }
+
+      const TokenClass token_class = classify(i, token);
+      const FlagId id = (token_class.kind == TokenClass::kFlag) ? token_class.id : kUnknownFlag;
+      if (id != kUnknownFlag && !this->GetArgument(id).value) {
+        result.Set(id, StringView());
+        ++flags_encountered;
+        if (flags_encountered >= total_flags)
+          delim_encountered = true;
+        continue;
+      }
+
+      if (id != kUnknownFlag) {
+        if (i + 1 == tokens.size())
+          return result.Fail(ErrorCode::kMissingValue, token);
+        const StringView value = tokens[i + 1];
+        this->SetValue(id, result.Keep(value.data(), value.size(), true), result);
+        i++;
+        flags_encountered++;
+        if (flags_encountered >= total_flags)
+          delim_encountered = true;
+        continue;
+      }
+
+      if (token_class.kind == TokenClass::kSplit) {
+        const FlagId split_id = token_class.id;
+        const size_t separator = token_class.offset;
+        this->SetValue(split_id, result.Keep(current + separator + 1, size - separator - 1, true), result);
+        flags_encountered++;
+        if (flags_encountered >= total_flags)
+          delim_encountered = true;
+        continue;
+      }
+
+      // Then one character names run together, with any value attached to the last
+      if (token_class.kind == TokenClass::kShortGroup) {
+        const FlagId value_id = token_class.id;
+        const size_t end = token_class.offset;
+        if (value_id != kUnknownFlag && end == size && i + 1 == tokens.size())
+          return result.Fail(ErrorCode::kMissingValue, this->GetShortName(value_id, current[end - 1]));
+        for (size_t k = 1; k < end; ++k) {
+          const FlagId short_id = _short_ids[static_cast<unsigned char>(current[k])];
+          if (short_id != value_id)
+            result.Set(short_id, StringView());
+        }
+        if (value_id != kUnknownFlag && end < size) {
+          const size_t start = (current[end] == '=') ? end + 1 : end;
+          this->SetValue(value_id, result.Keep(current + start, size - start, true), result);
+        } else if (value_id != kUnknownFlag) {
+          const StringView value = tokens[++i];
+          this->SetValue(value_id, result.Keep(value.data(), value.size(), true), result);
+        }
+        flags_encountered += static_cast<int>(end - 1);
+        if (flags_encountered >= total_flags)
+          delim_encountered = true;
+        continue;
+      }
+
+      // Otherwise set to non-flag
+      this->AddNonFlag(current, size, result, defer_copy);
+    }
+    token_trace.End();
+
+    const size_t nonflags = result._nonflag_count;
+    if (nonflags != _nonflags_required && _nonflags_required == 0 && !_nonflag_handler)
+      return result.Fail(ErrorCode::kUnknownArguments);
+    else if (nonflags != _nonflags_required && _nonflags_required != 0)
+      return result.Fail(ErrorCode::kNonFlagCount);
+
+    SARGS_STATS(result._stats.tokens = tokens.size() - 1;)
+    ErrorCode error = ErrorCode::kNone;
+    {
+      SARGS_STATS(StatsTimer timer(result._stats.check_values_ns);)
+      TraceSpan check_span(result._tracer, "CheckForValues");
+      error = this->CheckForValues(result);
+    }
+    if (error == ErrorCode::kNone) {
+      TraceSpan check_span(result._tracer, "CheckForMissing");
+      error = this->CheckForMissing(result);
+    }
+    return error;
+  }
+};
+
+inline std::string ParseResult::FindAlternative(const StringView& flag) const {
+  if (_schema == nullptr)
+    return "";
+  return _schema->FindAlternative(flag);
+}
+
+inline std::string ParseResult::FormatError() const {
+  std::ostringstream output;
+  this->WriteError(output);
+  return output.str();
+}
+
+inline void ParseResult::WriteError(std::ostream& output) const {
+  switch (_error_code) {
+    case ErrorCode::kNone:
+      break;
+    case ErrorCode::kUnknownArguments:
+      output << "Unknown arguments";
+      break;
+    case ErrorCode::kNonFlagCount:
+      output << "Unknown arguments or user must specify " << _schema->GetNonFlagsRequired() << " non-flags";
+      break;
+    case ErrorCode::kMissingValue:
+      output << "Must set value for " << _error_subject;
+      break;
+    case ErrorCode::kMissingFlag:
+      output << "Must specify " << _error_subject;
+      break;
+    case ErrorCode::kMissingFlagValue:
+      output << "Must specify value for " << _error_subject;
+      break;
+    case ErrorCode::kResponseFileDepth:
+      output << "Response files nested too deeply at " << _error_subject;
+      break;
+    case ErrorCode::kResponseFileRead:
+      output << "Could not read response file " << _error_subject;
+      break;
+    case ErrorCode::kBinaryFile:
+      output << "Could not map " << _error_subject << " for " << _error_flag;
+      break;
+    case ErrorCode::kTooManyFlags:
+      output << "Too many flags registered";
+      break;
+    case ErrorCode::kTooManyArguments:
+      output << "Too many arguments";
+      break;
+    case ErrorCode::kOutOfSpace:
+      output << "Out of space for flag names and descriptions";
+      break;
+  }
+}
+
+inline FlagId ParseResult::FindId(const StringView& flag) const {
+  return _schema->FindId(flag, this->Stats());
+}
+
+inline const StringView* ParseResult::Find(const StringView& flag) const {
+  if (_schema == nullptr)
+    return nullptr;
+  const FlagId id = this->FindId(flag);
+  if (!this->IsPresent(id))
+    return nullptr;
+  return &_values[id];
+}
+
+class Args {
+ public:
+#if !defined(SARGS_FIXED_CAPACITY)
+  Args() = default;
+
+  // Keeps the flags, parsed values and non-flag storage in arena, which must outlive Args
+  explicit Args(Arena* arena) : _schema(arena), _result(arena) {}
+#else
+  // Everything is kept in _memory, reserved up front for the largest registry and argv allowed
+  Args() : _arena(_memory, kMemorySize, false), _schema(&_arena), _result(&_arena) {
+    _schema.Reserve(SARGS_MAX_FLAGS);
+    _result.Reserve(SARGS_MAX_FLAGS, SARGS_MAX_ARGS);
+  }
+#endif
+
+  ~Args() = default;
+
+  static Args& Default() {
+    static Args instance;
+    return instance;
+  }
+
+  bool GetAsString(const StringView& flag, std::string& value) const {
+    return _result.GetAsString(flag, value);
+  }
+
+  std::string GetAsString(const StringView& flag) const {
+    return _result.GetAsString(flag);
+  }
+
+  bool GetAsStringView(const StringView& flag, StringView& value) const {
+    return _result.GetAsStringView(flag, value);
+  }
+
+  StringView GetAsStringView(const StringView& flag) const {
+    return _result.GetAsStringView(flag);
+  }
+
+  bool GetAsFloat(const StringView& flag, float& value) const {
+    return _result.GetAsFloat(flag, value);
+  }
+
+  float GetAsFloat(const StringView& flag) const {
+    return _result.GetAsFloat(flag);
+  }
+
+  bool GetAsDouble(const StringView& flag, double& value) const {
+    return _result.GetAsDouble(flag, value);
+  }
+
+  double GetAsDouble(const StringView& flag) const {
+    return _result.GetAsDouble(flag);
+  }
+
+  bool GetAsUInt64(const StringView& flag, uint64_t& value) const {
+    return _result.GetAsUInt64(flag, value);
+  }
+
+  uint64_t GetAsUInt64(const StringView& flag) const {
+    return _result.GetAsUInt64(flag);
+  }
+
+  uint32_t GetAsUInt32(const StringView& flag) const {
+    return _result.GetAsUInt32(flag);
+  }
+
+  uint16_t GetAsUInt16(const StringView& flag) const {
+    return _result.GetAsUInt16(flag);
+  }
+
+  uint8_t GetAsUInt8(const StringView& flag) const {
+    return _result.GetAsUInt8(flag);
+  }
+
+  bool GetAsInt64(const StringView& flag, int64_t& value) const {
+    return _result.GetAsInt64(flag, value);
+  }
+
+  int64_t GetAsInt64(const StringView& flag) const {
+    return _result.GetAsInt64(flag);
+  }
+
+  int32_t GetAsInt32(const StringView& flag) const {
+    return _result.GetAsInt32(flag);
+  }
+
+  int16_t GetAsInt16(const StringView& flag) const {
+    return _result.GetAsInt16(flag);
+  }
+
+  int32_t GetAsInt8(const StringView& flag) const {
+    return _result.GetAsInt8(flag);
+  }
+
+  std::string FindAlternative(const StringView& flag) const {
+    return _schema.FindAlternative(flag);
+  }
+
+  bool Has(const StringView& flag) const {
+    return _result.Has(flag);
+  }
+
+  bool Has(const FlagId id) const {
+    return _result.Has(id);
+  }
+
+  StringView GetValue(const FlagId id) const {
+    return _result.GetValue(id);
+  }
+
+  FlagId FindId(const StringView& flag) const {
+    return _schema.FindId(flag);
+  }
+
+  std::string GetNonFlag(const size_t index) const {
+    return _result.GetNonFlag(index);
+  }
+
+  std::vector<std::string> GetNonFlags() const {
+    return _result.GetNonFlags();
+  }
+
+  const NonFlagList& GetNonFlagViews() const {
+    return _result.GetNonFlagViews();
+  }
+
+  size_t GetNonFlagCount() const {
+    return _result.GetNonFlagCount();
+  }
+
+  const ParseStats& GetStats() const {
+    return _result.GetStats();
+  }
+
+  bool GetAsFloatList(const StringView& flag, std::vector<float>& values, const char separator = ',') const {
+    return _result.GetAsFloatList(flag, values, separator);
+  }
+
+  std::vector<float> GetAsFloatList(const StringView& flag, const char separator = ',') const {
+    return _result.GetAsFloatList(flag, separator);
+  }
+
+  bool GetAsInt64List(const StringView& flag, std::vector<int64_t>& values, const char separator = ',') const {
+    return _result.GetAsInt64List(flag, values, separator);
+  }
+
+  std::vector<int64_t> GetAsInt64List(const StringView& flag, const char separator = ',') const {
+    return _result.GetAsInt64List(flag, separator);
+  }
+
+  bool GetAsUInt64List(const StringView& flag, std::vector<uint64_t>& values, const char separator = ',') const {
+    return _result.GetAsUInt64List(flag, values, separator);
+  }
+
+  std::vector<uint64_t> GetAsUInt64List(const StringView& flag, const char separator = ',') const {
+    return _result.GetAsUInt64List(flag, separator);
+  }
+
+  ArrayView<StringView> GetAll(const StringView& flag) const {
+    return _result.GetAll(flag);
+  }
+
+  template <typename T>
+  bool GetAsArray(const StringView& flag, ArrayView<T>& values) const {
+    return _result.GetAsArray(flag, values);
   }
 
-  bool GetAsInt64(const std::string& flag, int64_t& value) const {
-    if (flag.empty()) {
-      if (_exceptions_enabled)
-        throw SargsError("Flag query empty");
-      else
-        return false;
-    }
+  template <typename T>
+  ArrayView<T> GetAsArray(const StringView& flag) const {
+    return _result.GetAsArray<T>(flag);
+  }
 
-    auto iter = _arguments.find(flag);
-    if (iter == _arguments.end())
-      return false;
+  ArrayView<StringView> GetAll(const FlagId id) const {
+    return _result.GetAll(id);
+  }
 
-    const std::string value_str(iter->second);
-  #if defined(__linux) || defined(__clang__)
-    const int64_t myvalue = std::strtol(value_str.c_str(), nullptr, 0);
-  #elif defined(_WIN32)
-    const int64_t myvalue = std::strtoll(value_str.c_str(), nullptr, 0);
-  #endif
-    const bool range_error = (errno == ERANGE);
-    if (range_error) {
-      if (_exceptions_enabled)
-        throw SargsError("Could not convert " +  value_str + " to int64_t");
-      else
-        return false;
-    }
+  bool GetAllAsInt64(const StringView& flag, std::vector<int64_t>& values) const {
+    return _result.GetAllAsInt64(flag, values);
+  }
 
-    value = myvalue;
-    return true;
+  std::vector<int64_t> GetAllAsInt64(const StringView& flag) const {
+    return _result.GetAllAsInt64(flag);
   }
 
-  int64_t GetAsInt64(const std::string& flag) const {
-    int64_t value;
-    if (!this->GetAsInt64(flag, value)) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " was not specified");
-      else
-        return 0;
-    }
-    return value;
+  bool GetAllAsUInt64(const StringView& flag, std::vector<uint64_t>& values) const {
+    return _result.GetAllAsUInt64(flag, values);
   }
 
-  int32_t GetAsInt32(const std::string& flag) const {
-    int64_t value;
-    if (!this->GetAsInt64(flag, value)) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " was not specified");
-      else
-        return 0;
-    }
-    if (value > std::numeric_limits<int32_t>::max()) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " is too large to convert to int32_t: " + std::to_string(value));
-      else
-        return 0;
-    } else if (value < std::numeric_limits<int32_t>::min()) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " was too low to convert to int32_t" + std::to_string(value));
-      else
-        return 0;
-    }
-    return static_cast<int32_t>(value);
+  std::vector<uint64_t> GetAllAsUInt64(const StringView& flag) const {
+    return _result.GetAllAsUInt64(flag);
   }
 
-  int16_t GetAsInt16(const std::string& flag) const {
-    int64_t value;
-    if (!this->GetAsInt64(flag, value)) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " was not specified");
-      else
-        return 0;
-    }
-    if (value > std::numeric_limits<int16_t>::max()) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " is too large to convert to int16_t: " + std::to_string(value));
-      else
-        return 0;
-    } else if (value < std::numeric_limits<int16_t>::min()) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " is too small to convert to int16_t: " + std::to_string(value));
-      else
-        return 0;
-    }
-    return static_cast<int16_t>(value);
+  bool GetAllAsFloat(const StringView& flag, std::vector<float>& values) const {
+    return _result.GetAllAsFloat(flag, values);
   }
 
-  int32_t GetAsInt8(const std::string& flag) const {
-    int64_t value;
-    if (!this->GetAsInt64(flag, value)) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " was not specified");
-      else
-        return 0;
-    }
-    if (value > std::numeric_limits<int8_t>::max()) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " is too large to convert to int8_t: " + std::to_string(value));
-      else
-        return 0;
-    } else if (value < std::numeric_limits<int8_t>::min()) {
-      if (_exceptions_enabled)
-        throw SargsError(flag + " is too small to convert to int8_t: " + std::to_string(value));
-      else
-        return 0;
-    }
-    return static_cast<int8_t>(value);
+  std::vector<float> GetAllAsFloat(const StringView& flag) const {
+    return _result.GetAllAsFloat(flag);
   }
 
-  std::string FindAlternative(const std::string& flag) const {
-    for (auto iter : _required) {
-      if (iter.flag == flag)
-        return iter.alias;
-      if (iter.alias == flag)
-        return iter.flag;
-    }
-    for (auto iter : _optional) {
-      if (iter.flag == flag)
-        return iter.alias;
-      if (iter.alias == flag)
-        return iter.flag;
-    }
-    return "";
+  FlagId AddRequiredFlag(const StringView& flag, const StringView& alias, const StringView& description) {
+    return _schema.AddRequiredFlag(flag, alias, description);
   }
 
-  bool Has(const std::string& flag) const {
-    std::string alternative = this->FindAlternative(flag);
-    for (auto iter : _arguments) {
-      if ((iter.first == flag) || (iter.first == alternative))
-        return true;
-    }
-    return false;
+  FlagRegistration AddRequiredFlagValue(const StringView& flag, const StringView& alias,
+                                        const StringView& description) {
+    const FlagId id = _schema.AddRequiredFlagValue(flag, alias, description);
+    return FlagRegistration(*this, flag.empty() ? alias : flag, id);
   }
 
-  std::string GetNonFlag(const size_t index) const {
-    return _nonflags.at(index);
+  FlagRegistration AddRequiredFlagValue(const StringView& flag, const StringView& alias,
+                                        const StringView& description, const StringView& fallback) {
+    const FlagId id = _schema.AddRequiredFlagValue(flag, alias, description, fallback);
+    return FlagRegistration(*this, flag.empty() ? alias : flag, id);
   }
 
-  std::vector<std::string> GetNonFlags() const {
-    return _nonflags;
+  FlagId AddOptionalFlag(const StringView& flag, const StringView& alias, const StringView& description) {
+    return _schema.AddOptionalFlag(flag, alias, description);
+  }
+
+  FlagId AddRequiredRepeatedFlagValue(const StringView& flag, const StringView& alias,
+                                      const StringView& description) {
+    return _schema.AddRequiredRepeatedFlagValue(flag, alias, description);
+  }
+
+  FlagId AddOptionalRepeatedFlagValue(const StringView& flag, const StringView& alias,
+                                      const StringView& description) {
+    return _schema.AddOptionalRepeatedFlagValue(flag, alias, description);
+  }
+
+  void ReserveRepeatedValues(const size_t count) {
+    _schema.ReserveRepeatedValues(count);
   }
 
-  void AddRequiredFlag(const std::string& flag, const std::string& alias, const std::string& description) {
-    _required.emplace_back(flag, alias, description, false);
+#if !defined(SARGS_FIXED_CAPACITY)
+  FlagId AddRequiredBinaryFlagValue(const StringView& flag, const StringView& alias,
+                                    const StringView& description) {
+    return _schema.AddRequiredBinaryFlagValue(flag, alias, description);
   }
 
- void AddRequiredFlagValue(const std::string& flag, const std::string& alias, const std::string& description) {
-    _required.emplace_back(flag, alias, description, true, "");
- }
+  FlagId AddOptionalBinaryFlagValue(const StringView& flag, const StringView& alias,
+                                    const StringView& description) {
+    return _schema.AddOptionalBinaryFlagValue(flag, alias, description);
+  }
+#endif
 
-  void AddRequiredFlagValue(const std::string& flag, const std::string& alias, const std::string& description,
-                            const std::string& fallback) {
-    _required.emplace_back(flag, alias, description, true, fallback);
+  FlagRegistration AddOptionalFlagValue(const StringView& flag, const StringView& alias,
+                                        const StringView& description) {
+    const FlagId id = _schema.AddOptionalFlagValue(flag, alias, description);
+    return FlagRegistration(*this, flag.empty() ? alias : flag, id);
   }
 
-  void AddOptionalFlag(const std::string& flag, const std::string& alias, const std::string& description) {
-    _optional.emplace_back(flag, alias, description, false);
+  FlagRegistration AddOptionalFlagValue(const StringView& flag, const StringView& alias,
+                                        const StringView& description, const StringView& fallback) {
+    const FlagId id = _schema.AddOptionalFlagValue(flag, alias, description, fallback);
+    return FlagRegistration(*this, flag.empty() ? alias : flag, id);
   }
 
-  void AddOptionalFlagValue(const std::string& flag, const std::string& alias, const std::string& description) {
-    _optional.emplace_back(flag, alias, description, true, "");
+  // Creates a handle to the flag registered as id, whose value is converted to T once at the end of
+  // Initialize()
+  template <typename T>
+  Flag<T> GetFlag(const StringView& flag, const FlagId id) {
+    TypedFlagSlot<T>* slot = new TypedFlagSlot<T>(flag, id);
+    _slots.emplace_back(slot);
+    return Flag<T>(slot);
   }
 
-  void AddOptionalFlagValue(const std::string& flag, const std::string& alias, const std::string& description,
-                            const std::string& fallback) {
-    _optional.emplace_back(flag, alias, description, true, fallback);
+  // Registers an optional flag whose value is converted once during Initialize() and stored in *target.
+  // bool targets are set to true when the flag is given and take no value. Supported value types are
+  // std::string, sargs::StringView, float, double and the integer types.
+  template <typename T>
+  FlagId Bind(const StringView& flag, const StringView& alias, T* target, const StringView& description) {
+    const FlagId id = StaticTakesValue<T>::value ? _schema.AddOptionalFlagValue(flag, alias, description)
+                                                 : _schema.AddOptionalFlag(flag, alias, description);
+    _slots.emplace_back(new BoundFlagSlot<T>(flag.empty() ? alias : flag, id, target));
+    return id;
   }
 
   void RequireNonFlags(const int count) {
-    _nonflags_required = count;
+    _schema.RequireNonFlags(count);
+  }
+
+  void SetNonFlagHandler(const NonFlagHandler& handler) {
+    _schema.SetNonFlagHandler(handler);
   }
 
-  void PrintUsage(std::ostream& output) {
-    output << _preamble << _flag_description << _epilogue;
+  // Generated parts of the usage are written straight to output rather than built up first
+  void PrintUsage(std::ostream& output) const {
+    SARGS_STATS(StatsTimer timer(_result._stats.usage_ns);)
+    if (_preamble_stale)
+      this->WritePreamble(output);
+    else
+      output << _preamble;
+    if (_flag_description_stale)
+      this->WriteFlagDescription(output);
+    else
+      output << _flag_description;
+    output << _epilogue;
   }
 
   void SetPreamble(const std::string& preamble) {
     _preamble = preamble;
+    _preamble_stale = false;
   }
 
   void SetEpilogue(const std::string& epilogue) {
     _epilogue = epilogue;
   }
 
-  void SetFlagDescription(const std::string& flag_description) {
+  void SetFlagDescription(const StringView& flag_description) {
     _flag_description = flag_description;
+    _flag_description_stale = false;
   }
 
   void DisableHelp() {
@@ -400,13 +3297,32 @@ class Args {
   }
 
   void DisableExceptions() {
-    _exceptions_enabled = false;
+    _schema.DisableExceptions();
   }
 
   void DisableUsage() {
     _usage_enabled = false;
   }
 
+  // Keep values and non-flags as views into argv instead of copying them. argv must outlive Args.
+  void EnableArgvViews() {
+    _schema.EnableArgvViews();
+  }
+
+#if !defined(SARGS_FIXED_CAPACITY)
+  void EnableResponseFiles() {
+    _schema.EnableResponseFiles();
+  }
+
+  void EnableParallelParse(const size_t threads = 0) {
+    _schema.EnableParallelParse(threads);
+  }
+
+  void EnableParallelParse(const size_t threads, const size_t min_tokens) {
+    _schema.EnableParallelParse(threads, min_tokens);
+  }
+#endif
+
   void SetDescStartColumn(const unsigned column) {
     _desc_start = column;
   }
@@ -416,6 +3332,14 @@ class Args {
   }
 
   std::string GetPreamble() const {
+    if (_preamble_stale) {
+      SARGS_STATS(StatsTimer timer(_result._stats.usage_ns);)
+      TraceSpan span(_tracer.get(), "GenerateUsage");
+      std::ostringstream output;
+      this->WritePreamble(output);
+      _preamble = output.str();
+      _preamble_stale = false;
+    }
     return _preamble;
   }
 
@@ -424,246 +3348,178 @@ class Args {
   }
 
   std::string GetFlagDescription() const {
+    if (_flag_description_stale) {
+      SARGS_STATS(StatsTimer timer(_result._stats.usage_ns);)
+      TraceSpan span(_tracer.get(), "GenerateUsage");
+      std::ostringstream output;
+      this->WriteFlagDescription(output);
+      _flag_description = output.str();
+      _flag_description_stale = false;
+    }
     return _flag_description;
   }
 
   std::string GetBinary() const {
-    return _binary;
+    return _result.GetBinary();
+  }
+
+  const Schema& GetSchema() const {
+    return _schema;
+  }
+
+  const ParseResult& GetResult() const {
+    return _result;
+  }
+
+  // Forgets the previous parse while keeping its memory. Initialize() may then be called again with new
+  // arguments; as long as no flags were registered in between it reuses the index and usage text.
+  void Reset() {
+    _result.Clear();
   }
 
   void Initialize(int argc, char* argv[]) {
-    if (_help_enabled)
+    if (!_tracer_checked) {
+#if !defined(SARGS_FIXED_CAPACITY)
+      if (!_tracer)
+        _tracer = Tracer::FromEnvironment();
+#endif
+      _result.SetTracer(_tracer.get());
+      _tracer_checked = true;
+    }
+    TraceSpan initialize_span(_tracer.get(), "Initialize");
+
+    if (_help_enabled && !_help_registered) {
+      TraceSpan span(_tracer.get(), "RegisterHelp");
       this->AddOptionalFlag("--help", "-h", "Print usage and options information");
+      _help_registered = true;
+    }
 
-    std::string result = this->Parse(argc, argv);
-    this->GenerateUsage();
-    const bool help_specified = this->Has("--help") || this->Has("-h");
-    const bool usage = (_help_enabled && help_specified) || !result.empty();
+    const bool schema_changed = !_schema.IsCompiled();
+    if (schema_changed) {
+      TraceSpan span(_tracer.get(), "Compile");
+      _schema.Compile();
+    }
+    _schema.Parse(argc, argv, _result);
+    const bool failed = (_result.GetErrorCode() != ErrorCode::kNone);
+    if (schema_changed) {
+      // The usage is only generated if it is asked for
+      _preamble_stale = true;
+      _flag_description_stale = true;
+    }
+    const bool help_specified = _result.Has(_schema.FindId("--help", 6)) || _result.Has(_schema.FindId("-h", 2));
+    const bool usage = (_help_enabled && help_specified) || failed;
 
     if (usage) {
       if (_usage_enabled) {
+        TraceSpan span(_tracer.get(), "PrintUsage");
         this->PrintUsage(std::cout);
-        if (!result.empty())
-          std::cout << "\nError: " << result << "\n"  << std::endl;
+        if (failed) {
+          std::cout << "\nError: ";
+#if defined(SARGS_FIXED_CAPACITY)
+          // Written from the code and subject rather than GetError(), which would allocate
+          _result.WriteError(std::cout);
+#else
+          std::cout << _result.GetError();
+#endif
+          std::cout << "\n"  << std::endl;
+        }
       }
 
       if (_exit_enabled) {
-        if (result.empty())
+        this->FlushTrace(initialize_span);
+        if (!failed)
           exit(0);
         else
           exit(1);
       }
     }
 
-    this->AddFallbackValues();
+    {
+      TraceSpan span(_tracer.get(), "LoadSlots");
+      for (auto& slot : _slots)
+        slot->Load(_result);
+    }
+    this->FlushTrace(initialize_span);
+  }
+
+  // Traces each Initialize() to path as Chrome trace_event JSON, replacing any tracer from SARGS_TRACE.
+  // With token_events an event is also recorded for every argument.
+  void EnableTracing(const std::string& path, const bool token_events = false) {
+    _tracer.reset(new Tracer(path, token_events));
+    _result.SetTracer(_tracer.get());
+    _tracer_checked = true;
   }
 
  private:
-  std::vector<Argument> _required;
-  std::vector<Argument> _optional;
-  std::map<std::string, std::string> _arguments;
-  std::vector<std::string> _nonflags;
-  std::string _binary;
-  std::string _flag_description;
+#if defined(SARGS_FIXED_CAPACITY)
+  static const size_t kMemorySize = Schema::ReservedBytes(SARGS_MAX_FLAGS) +
+                                    ParseResult::ReservedBytes(SARGS_MAX_FLAGS, SARGS_MAX_ARGS) +
+                                    SARGS_MAX_STRING_BYTES;
+  char _memory[kMemorySize];
+  Arena _arena;
+#endif
+  Schema _schema;
+  ParseResult _result;
+  // Null unless tracing was enabled, in which case spans are written out at the end of each Initialize()
+  std::unique_ptr<Tracer> _tracer;
+  bool _tracer_checked = false;
+  std::vector<std::unique_ptr<FlagSlot>> _slots;
+  mutable std::string _flag_description;
   std::string _epilogue;
-  std::string _preamble;
-  size_t _nonflags_required = 0;
+  mutable std::string _preamble;
+  // Set when the schema changed since the generated parts of the usage were last written
+  mutable bool _flag_description_stale = false;
+  mutable bool _preamble_stale = false;
   bool _help_enabled = true;
+  bool _help_registered = false;
   bool _exit_enabled = true;
-  bool _exceptions_enabled = true;
   bool _usage_enabled = true;
   unsigned _desc_start = 30;
   unsigned _desc_width = 50;
 
-  bool CheckIfNonValueFlag(const std::string& flag) const {
-    for (auto iter : _required) {
-      if (flag == iter.flag || flag == iter.alias)
-        return !iter.value;
-    }
-
-    for (auto iter : _optional) {
-      if (flag == iter.flag || flag == iter.alias)
-        return !iter.value;
-    }
-
-    return false;
-  }
-
-  bool CheckIfValueFlag(const std::string& flag) const {
-    for (auto iter : _required) {
-      if (flag == iter.flag || flag == iter.alias)
-        return iter.value;
-    }
-
-    for (auto iter : _optional) {
-      if (flag == iter.flag || flag == iter.alias)
-        return iter.value;
-    }
-
-    return false;
-  }
-
-  std::string CheckForMissing(const std::vector<Argument>& to_check) {
-    for (auto iter : to_check) {
-      auto flag_iter = _arguments.find(iter.flag);
-      auto alias_iter = _arguments.find(iter.alias);
-      if (flag_iter == _arguments.end() && alias_iter == _arguments.end()) {
-        std::stringstream err;
-        if (!iter.flag.empty())
-          err << "Must specify " + iter.flag;
-        else
-          err << "Must specify " + iter.alias;
-        return err.str();
-      }
-    }
-    return "";
+  static bool IsAlpha(const char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) != 0;
   }
 
-  std::string CheckForValues(const std::vector<Argument>& to_check) {
-    for (auto iter : to_check) {
-      auto arg_iter = _arguments.find(iter.flag);
-      if (arg_iter != _arguments.end() && !iter.alias.empty()) {
-        if (iter.value && arg_iter->second.empty()) {
-          std::stringstream err;
-          err << "Must specify value for " + iter.flag;
-          return err.str();
-        }
-
-        _arguments[iter.alias] = arg_iter->second;
-        continue;
-      }
-
-      arg_iter = _arguments.find(iter.alias);
-      if (arg_iter != _arguments.end() && !arg_iter->second.empty()) {
-        if (iter.value && arg_iter->second.empty()) {
-          std::stringstream err;
-          err << "Must specify value for " + iter.alias;
-          return err.str();
-        }
-
-        _arguments[iter.flag] = arg_iter->second;
-        continue;
-      }
-    }
-    return "";
+  // Ends the Initialize() span early so it is included, then writes everything recorded
+  void FlushTrace(TraceSpan& initialize_span) {
+    if (!_tracer)
+      return;
+    initialize_span.End();
+    if (!_tracer->Flush())
+      std::cerr << "Could not write trace" << std::endl;
   }
 
-  bool TryFlagValueSplit(const std::string& arg, std::pair<std::string, std::string>& flag_value) {
-    size_t pos = arg.find_first_of('=');
-    std::string current_flag(arg.substr(0, pos));
-    const bool has_separator = (pos != std::string::npos);
-    const bool is_expected = this->CheckIfValueFlag(current_flag);
-    if (has_separator && is_expected) {
-      flag_value.first = current_flag;
-      flag_value.second = arg.substr(pos + 1);
-      return true;
-    }
-    return false;
+  static bool IsBlank(const char c) {
+    return c == ' ' || c == '\t';
   }
 
-  void AddFallbackValues() {
-    for (auto iter : _optional) {
-      auto flag_iter = _arguments.find(iter.flag);
-      if (flag_iter == _arguments.end() && !iter.fallback.empty())
-        _arguments[iter.flag] = iter.fallback;
-
-      auto alias_iter = _arguments.find(iter.alias);
-      if (alias_iter == _arguments.end() && !iter.fallback.empty())
-        _arguments[iter.alias] = iter.fallback;
-    }
-
-    for (auto iter : _required) {
-      auto flag_iter = _arguments.find(iter.flag);
-      if (flag_iter == _arguments.end() && !iter.fallback.empty())
-        _arguments[iter.flag] = iter.fallback;
-
-      auto alias_iter = _arguments.find(iter.alias);
-      if (alias_iter == _arguments.end() && !iter.fallback.empty())
-        _arguments[iter.alias] = iter.fallback;
-    }
+  static void WriteSpaces(std::ostream& output, const size_t count) {
+    for (size_t i = 0; i < count; ++i)
+      output.put(' ');
   }
 
-  std::string Parse(int argc, char* argv[]) {
-    _binary = argv[0];
-    const int total_flags = _required.size() + _optional.size();
-    int flags_encountered = 0;
-    bool delim_encountered = false;
-    for (int i = 1; i < argc; ++i) {
-      // Check if we encountered the non-flag delimiter
-      const std::string current(argv[i]);
-      if (current == std::string("--")) {
-        delim_encountered = true;
-        continue;
-      }
-
-      // Check for explicit non-flags
-      if (delim_encountered) {
-        _nonflags.push_back(argv[i]);
-        continue;
-      }
-
-      if (this->CheckIfNonValueFlag(current)) {
-        _arguments[current] = "";
-        ++flags_encountered;
-        if (flags_encountered >= total_flags)
-          delim_encountered = true;
-        continue;
-      }
-
-      if (this->CheckIfValueFlag(current)) {
-        if (i + 1 == argc)
-          return "Must set value for " + current;
-        _arguments[current] = argv[i + 1];
-        i++;
-        flags_encountered++;
-        if (flags_encountered >= total_flags)
-          delim_encountered = true;
-        continue;
-      }
-
-      std::pair<std::string, std::string> flag_value;
-      if (this->TryFlagValueSplit(current, flag_value)) {
-        _arguments[flag_value.first] = flag_value.second;
-        flags_encountered++;
-        if (flags_encountered >= total_flags)
-          delim_encountered = true;
-        continue;
-      }
-
-      // Otherwise set to non-flag
-      _nonflags.push_back(argv[i]);
+  // Wraps a description to _desc_width columns in a single pass. Each line breaks after the last character
+  // within the width that is not a letter, or at the width if the line is one word, and leading blanks
+  // are dropped. Continuation lines are indented to _desc_start.
+  void WriteDescription(std::ostream& output, const StringView& description) const {
+    const size_t size = description.size();
+    if (size <= _desc_width) {
+      output << description;
+      return;
     }
 
-    if (_nonflags.size() != _nonflags_required && _nonflags_required == 0)
-      return "Unknown arguments";
-    else if (_nonflags.size() != _nonflags_required)
-      return "Unknown arguments or user must specify " + std::to_string(_nonflags_required) + " non-flags";
-
-    std::string result = this->CheckForValues(_required);
-    if (result.empty())
-      result = this->CheckForValues(_optional);
-    if (result.empty())
-      result = this->CheckForMissing(_required);
-    return result;
-  }
-
-  size_t DetermineNumCharsToWrite(const std::string& description) const {
-    size_t location = _desc_width - 1;
-    while (std::isalpha(description[location]) && location > 0) --location;
-    if (location == 0 && std::isalpha(description[location])) return _desc_width;
-    return location + 1;
-  }
-
-  std::string FormatDescription(const std::string& description) const {
-    if (description.size() <= _desc_width) return description;
-    std::stringstream stream;
+    const char* text = description.data();
     size_t count = 0;
-    while (count < (description.size() - _desc_width)) {
-      size_t to_write = this->DetermineNumCharsToWrite(description.substr(count));
+    while (count < size - _desc_width) {
+      size_t location = _desc_width - 1;
+      while (location > 0 && IsAlpha(text[count + location]))
+        --location;
+      const size_t to_write = (location == 0 && IsAlpha(text[count])) ? _desc_width : location + 1;
 
       // Determine where to start writing the next line
       size_t skip = 0;
-      while (std::isblank(description[count + skip]) && (skip < _desc_width))
+      while (skip < _desc_width && IsBlank(text[count + skip]))
         ++skip;
 
       // Don't write a blank line
@@ -671,99 +3527,269 @@ class Args {
       if (skip == _desc_width)
         continue;
 
-      stream << description.substr(count, to_write) << "\n" << std::string(_desc_start, ' ');
+      output.write(text + count, static_cast<std::streamsize>(std::min(to_write, size - count)));
+      output.put('\n');
+      WriteSpaces(output, _desc_start);
       count += to_write;
     }
 
-    // Determine where to start writing the next line
-    size_t skip = 0;
-    while (std::isblank(description[count]) && count < _desc_width) ++skip;
-    if (skip != _desc_width) {
-      count += skip;
-      stream.write(&description[count], int(description.size() - count));
-    }
-    return stream.str();
-  }
-
-  std::string GenerateArgumentUsage(const std::vector<Argument>& arguments) const {
-    std::stringstream output;
-    for (size_t i = 0; i < arguments.size(); ++i) {
-      std::stringstream flag_ids;
-      flag_ids << "    " << arguments[i].flag;
-      if (arguments[i].value)
-        flag_ids << "=value";
-      if (!arguments[i].flag.empty() && !arguments[i].alias.empty())
-        flag_ids << "/";
-      if (!arguments[i].alias.empty()) {
-        flag_ids << arguments[i].alias;
-        if (arguments[i].value)
-          flag_ids << "=value";
+    while (count < size && IsBlank(text[count]))
+      ++count;
+    if (count < size)
+      output.write(text + count, static_cast<std::streamsize>(size - count));
+  }
+
+  void WriteArgumentUsage(std::ostream& output, const Vector<FlagId>& ids) const {
+    for (const FlagId id : ids) {
+      const Argument& argument = _schema.GetArgument(id);
+      const size_t value_size = argument.value ? 6 : 0;
+      size_t names_size = 4 + argument.flag.size() + value_size;
+      if (!argument.flag.empty() && !argument.alias.empty())
+        names_size += 1;
+      if (!argument.alias.empty())
+        names_size += argument.alias.size() + value_size;
+
+      output << "    ";
+      output << argument.flag;
+      if (argument.value)
+        output << "=value";
+      if (!argument.flag.empty() && !argument.alias.empty())
+        output << "/";
+      if (!argument.alias.empty()) {
+        output << argument.alias;
+        if (argument.value)
+          output << "=value";
       }
+      if (names_size < _desc_start)
+        WriteSpaces(output, _desc_start - names_size);
 
-      output << std::left << std::setw(_desc_start) << flag_ids.str();
-      output << std::left << this->FormatDescription(arguments[i].description);
-      output << '\n';
+      this->WriteDescription(output, argument.description);
+      output.put('\n');
     }
-    return output.str();
   }
 
-  void GenerateUsage() {
-    std::stringstream output;
-    if (_required.size() > 0)
+  void WriteFlagDescription(std::ostream& output) const {
+    const Vector<FlagId>& required = _schema.GetRequired();
+    const Vector<FlagId>& optional = _schema.GetOptional();
+    const size_t nonflags_required = _schema.GetNonFlagsRequired();
+    if (required.size() > 0)
       output << "\n  Required flags:\n";
-    output << this->GenerateArgumentUsage(_required);
+    this->WriteArgumentUsage(output, required);
 
-    if (_optional.size() > 0)
+    if (optional.size() > 0)
       output << "\n  Optional flags:\n";
-    output << this->GenerateArgumentUsage(_optional);
+    this->WriteArgumentUsage(output, optional);
 
-    if (_nonflags_required > 0) {
-      output << "\n  " << _nonflags_required << " non-flags are required" << std::endl;
-    }
-
-    _flag_description = output.str();
+    if (nonflags_required > 0)
+      output << "\n  " << nonflags_required << " non-flags are required\n";
+  }
 
-    output.str("");
-    output << "Usage: " << _binary << ' ';
-    for (size_t i = 0; i < _optional.size(); ++i) {
-      output << "[" << _optional[i].flag;
-      if (!_optional[i].flag.empty()) {
-        if (_optional[i].value)
+  void WritePreamble(std::ostream& output) const {
+    const Vector<FlagId>& required = _schema.GetRequired();
+    const Vector<FlagId>& optional = _schema.GetOptional();
+    const size_t nonflags_required = _schema.GetNonFlagsRequired();
+    output << "Usage: " << _result._binary << ' ';
+    for (size_t i = 0; i < optional.size(); ++i) {
+      const Argument& argument = _schema.GetArgument(optional[i]);
+      output << "[" << argument.flag;
+      if (!argument.flag.empty()) {
+        if (argument.value)
           output << "=value";
       }
 
-      if (!_optional[i].alias.empty()) {
-        output << "|" << _optional[i].alias;
-        if (_optional[i].value)
+      if (!argument.alias.empty()) {
+        output << "|" << argument.alias;
+        if (argument.value)
           output << "=value";
       }
       output << "] ";
     }
 
-    for (size_t i = 0; i < _required.size(); ++i) {
-      output << _required[i].flag;
-      if (_required[i].value)
+    for (size_t i = 0; i < required.size(); ++i) {
+      const Argument& argument = _schema.GetArgument(required[i]);
+      output << argument.flag;
+      if (argument.value)
         output << "=value";
-      if (!_required[i].alias.empty()) {
-          output << "|" << _required[i].alias;
-          if (_required[i].value)
+      if (!argument.alias.empty()) {
+          output << "|" << argument.alias;
+          if (argument.value)
             output << "=value";
       }
       output << " ";
     }
 
-    if (_nonflags_required > 0) {
+    if (nonflags_required > 0) {
       output << "<--> ";
-      for (size_t i = 0; i < _nonflags_required; ++i) {
+      for (size_t i = 0; i < nonflags_required; ++i) {
         output << "nonflag" << i + 1 << " ";
       }
     }
 
     output << "\n";
-    _preamble = output.str();
   }
 };
 
+template <typename T>
+FlagRegistration::operator Flag<T>() const {
+  return _args.GetFlag<T>(_flag, _id);
+}
+
+//
+// Compile-time schemas
+//
+// A schema known at compile time can be declared with SARGS_STATIC_SCHEMA instead of registering flags
+// with Args. The macro generates a struct with one member per flag and a switch over the compile-time
+// hashes of every flag and alias, so matching a token costs one hash of its bytes, one jump and one
+// comparison to confirm the name. Two names with the same hash are duplicate case labels, which the
+// compiler rejects, so the hash is known to be perfect for the schema.
+//
+
+// Compile-time version of FlagIndex::Hash()
+constexpr uint64_t StaticHash(const char* name, const uint64_t hash = 14695981039346656037ULL) {
+  return *name == '\0' ? hash
+                       : StaticHash(name + 1, (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ULL);
+}
+
+// Case labels for a flag's name and alias. A flag missing either gets a label derived from the other
+// instead so that every label stays unique; a token that happens to hash to it fails the name comparison.
+constexpr uint64_t StaticFlagHash(const char* flag, const char* alias) {
+  return *flag == '\0' ? ~StaticHash(alias) : StaticHash(flag);
+}
+
+constexpr uint64_t StaticAliasHash(const char* flag, const char* alias) {
+  return *alias == '\0' ? ~StaticHash(flag) : StaticHash(alias);
+}
+
+inline bool StaticNameEquals(const char* token, const size_t size, const char* name) {
+  return *name != '\0' && std::strlen(name) == size && std::memcmp(token, name, size) == 0;
+}
+
+// Conversions used by static schemas. Values come straight from argv, so text is NUL terminated.
+inline bool ConvertStatic(const char*, const size_t, bool& value) {
+  value = true;
+  return true;
+}
+
+inline bool ConvertStatic(const char* text, const size_t size, std::string& value) {
+  value.assign(text, size);
+  return true;
+}
+
+inline bool ConvertStatic(const char* text, const size_t size, StringView& value) {
+  value = StringView(text, size);
+  return true;
+}
+
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, bool>::type
+ConvertStatic(const char* text, const size_t size, T& value) {
+  return ConvertNumber(text, size, value);
+}
+
+// Parses argv into a struct generated by SARGS_STATIC_SCHEMA. Follows the rules of Schema::Parse() except
+// for one character names run together: "--" and every token after it are non-flags, values may follow
+// the flag or be joined with '=', and once every flag has been seen the remaining tokens are non-flags.
+// Groups such as -abc and joined short values such as -p2 are only read by Schema::Parse(); here they
+// are non-flags. Returns an empty string on success.
+template <typename Struct>
+std::string ParseStatic(Struct& out, int argc, char* argv[]) {
+  const int total_flags = Struct::kFlagCount;
+  int flags_encountered = 0;
+  bool delim_encountered = false;
+  for (int i = 1; i < argc; ++i) {
+    // Hash the name and find the '=' and the end of the token in one pass
+    const char* token = argv[i];
+    uint64_t hash = 14695981039346656037ULL;
+    size_t name_size = 0;
+    while (token[name_size] != '\0' && token[name_size] != '=') {
+      hash = (hash ^ static_cast<unsigned char>(token[name_size])) * 1099511628211ULL;
+      ++name_size;
+    }
+    const bool has_separator = (token[name_size] == '=');
+    const size_t size = has_separator ? name_size + 1 + std::strlen(token + name_size + 1) : name_size;
+
+    if (size == 2 && token[0] == '-' && token[1] == '-') {
+      delim_encountered = true;
+      continue;
+    }
+
+    const int field = delim_encountered ? -1 : Struct::Find(hash, token, name_size);
+    const bool takes_value = (field >= 0) && Struct::TakesValue(field);
+    if (field < 0 || (has_separator && !takes_value)) {
+      out.nonflags.push_back(StringView(token, size));
+      continue;
+    }
+
+    const char* value = "";
+    size_t value_size = 0;
+    if (takes_value && has_separator) {
+      value = token + name_size + 1;
+      value_size = size - name_size - 1;
+    } else if (takes_value) {
+      if (i + 1 == argc)
+        return "Must set value for " + std::string(token);
+      value = argv[++i];
+      value_size = std::strlen(value);
+    }
+
+    if (!out.Assign(field, value, value_size))
+      return "Could not convert " + std::string(value, value_size) + " for " + std::string(token, name_size);
+
+    ++flags_encountered;
+    if (flags_encountered >= total_flags)
+      delim_encountered = true;
+  }
+  return "";
+}
+
+template <typename T>
+void TypedFlagSlot<T>::Load(const ParseResult& result) {
+  value = T();
+  present = false;
+  if (!result.Has(id))
+    return;
+
+  // Without exceptions a value that cannot be converted reads as T()
+  const StringView text = result.GetValue(id);
+  if (!ConvertStatic(text.data(), text.size(), value) && result.ExceptionsEnabled())
+    throw SargsError("Could not convert " + std::string(text) + " for " + flag);
+  present = true;
+}
+
+template <typename T>
+void BoundFlagSlot<T>::Load(const ParseResult& result) {
+  present = result.Has(id);
+  if (!present)
+    return;
+
+  const StringView value = result.GetValue(id);
+  if (!ConvertStatic(value.data(), value.size(), *target) && result.ExceptionsEnabled())
+    throw SargsError("Could not convert " + std::string(value) + " for " + flag);
+}
+
+#define SARGS_STATIC_MEMBER(type, member, flag, alias, description) \
+  type member = type();
+
+#define SARGS_STATIC_FIELD(type, member, flag, alias, description) \
+  member##_flag,
+
+#define SARGS_STATIC_CASE(type, member, flag, alias, description) \
+  case sargs::StaticFlagHash(flag, alias): \
+  case sargs::StaticAliasHash(flag, alias): \
+    if (sargs::StaticNameEquals(token, size, flag) || sargs::StaticNameEquals(token, size, alias)) \
+      return member##_flag; \
+    return -1;
+
+#define SARGS_STATIC_TAKES_VALUE(type, member, flag, alias, description) \
+  case member##_flag: \
+    return sargs::StaticTakesValue<type>::value;
+
+#define SARGS_STATIC_ASSIGN(type, member, flag, alias, description) \
+  case member##_flag: \
+    if (!sargs::ConvertStatic(value, size, member)) \
+      return false; \
+    break;
+
 // Parses and verifies the arguments to ensure the flags are recognized and well-formed
 #define SARGS_INITIALIZE(argc, argv) \
   sargs::Args::Default().Initialize(argc, argv)
@@ -772,7 +3798,8 @@ class Args {
 #define SARGS_REQUIRED_FLAG(flag, alias, description) \
   sargs::Args::Default().AddRequiredFlag(flag, alias, description)
 
-// Tells Sargs that a flag is required and will have a value with no default value
+// Tells Sargs that a flag is required and will have a value with no default value. The result can be
+// assigned to a sargs::Flag<T> to read the converted value without a lookup.
 #define SARGS_REQUIRED_FLAG_VALUE(flag, alias, description) \
   sargs::Args::Default().AddRequiredFlagValue(flag, alias, description, "")
 
@@ -788,6 +3815,26 @@ class Args {
 #define SARGS_OPTIONAL_FLAG_VALUE(flag, alias, description) \
   sargs::Args::Default().AddOptionalFlagValue(flag, alias, description, "")
 
+// Tells Sargs that a flag with a value is required and may be given more than once
+#define SARGS_REQUIRED_REPEATED_FLAG_VALUE(flag, alias, description) \
+  sargs::Args::Default().AddRequiredRepeatedFlagValue(flag, alias, description)
+
+// Tells Sargs that a flag is required and its value names a binary file, e.g. --ids=@ids.u64
+#define SARGS_REQUIRED_BINARY_FLAG_VALUE(flag, alias, description) \
+  sargs::Args::Default().AddRequiredBinaryFlagValue(flag, alias, description)
+
+// Tells Sargs that an optional flag's value names a binary file, e.g. --ids=@ids.u64
+#define SARGS_OPTIONAL_BINARY_FLAG_VALUE(flag, alias, description) \
+  sargs::Args::Default().AddOptionalBinaryFlagValue(flag, alias, description)
+
+// Tells Sargs that an optional flag with a value may be given more than once
+#define SARGS_OPTIONAL_REPEATED_FLAG_VALUE(flag, alias, description) \
+  sargs::Args::Default().AddOptionalRepeatedFlagValue(flag, alias, description)
+
+// Binds an optional flag to a variable which is set during initialization if the flag is given
+#define SARGS_BIND(flag, alias, target, description) \
+  sargs::Args::Default().Bind(flag, alias, target, description)
+
 // Tells Sargs that an optional flag should be expected, will have a value and a default value
 #define SARGS_OPTIONAL_FLAG_VALUE_DEFAULT(flag, alias, description, fallback) \
   sargs::Args::Default().AddOptionalFlagValue(flag, alias, description, fallback)
@@ -840,6 +3887,38 @@ class Args {
 #define SARGS_GET_NONFLAGS() \
   sargs::Args::Default().GetNonFlags()
 
+// Pass each non-flag to handler, a callable taking a sargs::StringView, instead of storing them
+#define SARGS_SET_NONFLAG_HANDLER(handler) \
+  sargs::Args::Default().SetNonFlagHandler(handler)
+
+// Gets the number of non-flags given, including those passed to a handler
+#define SARGS_GET_NONFLAG_COUNT() \
+  sargs::Args::Default().GetNonFlagCount()
+
+// Gets what the last parse did as a sargs::ParseStats, all zero unless SARGS_ENABLE_STATS is defined
+#define SARGS_GET_STATS() \
+  sargs::Args::Default().GetStats()
+
+// Get a comma separated list of numbers as a std::vector<float>
+#define SARGS_GET_FLOAT_LIST(flag) \
+  sargs::Args::Default().GetAsFloatList(flag)
+
+// Get a comma separated list of numbers as a std::vector<int64_t>
+#define SARGS_GET_INT64_LIST(flag) \
+  sargs::Args::Default().GetAsInt64List(flag)
+
+// Get the contents of a binary flag's file as a sargs::ArrayView<type>
+#define SARGS_GET_ARRAY(type, flag) \
+  sargs::Args::Default().GetAsArray<type>(flag)
+
+// Get every value of a repeated flag as a sargs::ArrayView of sargs::StringView
+#define SARGS_GET_ALL(flag) \
+  sargs::Args::Default().GetAll(flag)
+
+// Get every value of a repeated flag as a std::vector<int64_t>
+#define SARGS_GET_ALL_INT64(flag) \
+  sargs::Args::Default().GetAllAsInt64(flag)
+
 // Get the value of a flag as an uint64_t
 #define SARGS_GET_UINT64(flag) \
   sargs::Args::Default().GetAsUInt64(flag)
@@ -880,10 +3959,58 @@ class Args {
 #define SARGS_GET_FLOAT(flag) \
   sargs::Args::Default().GetAsFloat(flag)
 
+// Get the value of a flag as a double
+#define SARGS_GET_DOUBLE(flag) \
+  sargs::Args::Default().GetAsDouble(flag)
+
 // Return a bool of the flag was specified
 #define SARGS_HAS(flag) \
   sargs::Args::Default().Has(flag)
 
+// Declares a struct named name whose members are filled from argv by a matcher generated at compile
+// time. FLAGS is an X-macro taking a macro X and calling X(type, member, flag, alias, description) for
+// each flag. bool members are flags without values; std::string, sargs::StringView, float, double and
+// integer members take a value. Members keep whatever value they had when their flag is not given, so
+// defaults are set by assigning them before calling Parse(argc, argv), which returns an empty string on
+// success. Tokens that are not flags are collected in nonflags.
+#define SARGS_STATIC_SCHEMA(name, FLAGS) \
+  struct name { \
+    enum Field { FLAGS(SARGS_STATIC_FIELD) kFlagCount }; \
+    FLAGS(SARGS_STATIC_MEMBER) \
+    std::vector<sargs::StringView> nonflags; \
+    static int Find(const uint64_t hash, const char* token, const size_t size) { \
+      switch (hash) { \
+        FLAGS(SARGS_STATIC_CASE) \
+        default: \
+          return -1; \
+      } \
+    } \
+    static bool TakesValue(const int flag) { \
+      switch (flag) { \
+        FLAGS(SARGS_STATIC_TAKES_VALUE) \
+        default: \
+          return false; \
+      } \
+    } \
+    bool Assign(const int flag, const char* value, const size_t size) { \
+      switch (flag) { \
+        FLAGS(SARGS_STATIC_ASSIGN) \
+        default: \
+          return false; \
+      } \
+      _present[flag] = true; \
+      return true; \
+    } \
+    bool Has(const Field flag) const { \
+      return _present[flag]; \
+    } \
+    std::string Parse(int argc, char* argv[]) { \
+      return sargs::ParseStatic(*this, argc, argv); \
+    } \
+   private: \
+    bool _present[kFlagCount + 1] = {}; \
+  }
+
 // Disable default -h and --help flags. These will do nothing if specified by
 // the user when this is called before SARGS_INITIALIZE()
 #define SARGS_DISABLE_HELP() \
@@ -901,6 +4028,26 @@ class Args {
 #define SARGS_DISABLE_USAGE() \
   sargs::Args::Default().DisableUsage()
 
+// Keeps values and non-flags as views into argv instead of copying them
+#define SARGS_ENABLE_ARGV_VIEWS() \
+  sargs::Args::Default().EnableArgvViews()
+
+// Expand @file arguments into the arguments listed in that file
+#define SARGS_ENABLE_RESPONSE_FILES() \
+  sargs::Args::Default().EnableResponseFiles()
+
+// Parse very large argument lists on one thread per core
+#define SARGS_ENABLE_PARALLEL_PARSE() \
+  sargs::Args::Default().EnableParallelParse()
+
+// Get the value of a flag as a sargs::StringView
+#define SARGS_GET_STRING_VIEW(flag) \
+  sargs::Args::Default().GetAsStringView(flag)
+
+// Gets all non-flags as views
+#define SARGS_GET_NONFLAG_VIEWS() \
+  sargs::Args::Default().GetNonFlagViews()
+
 // Sets the start column of each description in the usage generator. Default: 30
 #define SARGS_SET_DESC_START_COLUMN(column) \
   sargs::Args::Default().SetDescStartColumn(column)
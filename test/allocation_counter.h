@@ -0,0 +1,36 @@
+//
+// Replaces the global operator new and delete so tests can count the heap allocations made while
+// g_count_allocations is set. Include from one translation unit only.
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+static bool g_count_allocations = false;
+static size_t g_allocations = 0;
+
+// Kept out of line so GCC does not pair the inlined free() with the operator new it sees at the call site
+#if defined(__GNUC__)
+#define TEST_NOINLINE __attribute__((noinline))
+#else
+#define TEST_NOINLINE
+#endif
+
+TEST_NOINLINE void* operator new(size_t size) {
+  if (g_count_allocations)
+    ++g_allocations;
+  void* memory = std::malloc(size == 0 ? 1 : size);
+  if (memory == nullptr)
+    throw std::bad_alloc();
+  return memory;
+}
+
+TEST_NOINLINE void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+TEST_NOINLINE void operator delete(void* memory, size_t) noexcept {
+  std::free(memory);
+}
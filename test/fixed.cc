@@ -0,0 +1,214 @@
+// Built with a fixed capacity, small enough that every limit can be reached here
+#define SARGS_FIXED_CAPACITY
+#define SARGS_MAX_FLAGS 8
+#define SARGS_MAX_ARGS 16
+#define SARGS_MAX_STRING_BYTES 512
+#include "sargs.h"
+#include "allocation_counter.h"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+
+using namespace sargs;
+using namespace std;
+
+static inline bool AssertFailed(const std::string& message) {
+  cerr << "fail" << endl;
+  throw std::runtime_error(message);
+}
+
+#define Assert(x) ((x) || (AssertFailed(#x)))
+
+void TestNoAllocations() {
+  cout << "TestNoAllocations()...";
+
+  Args args;
+  args.DisableExit();
+  args.DisableUsage();
+  args.AddRequiredFlagValue("--port", "-p", "Port to listen on");
+  Flag<uint32_t> threads = args.AddOptionalFlagValue("--threads", "-t", "Worker threads", "4");
+  args.AddOptionalFlag("--verbose", "-v", "Verbose output");
+  const FlagId include = args.AddOptionalRepeatedFlagValue("--include", "-I", "Include directory");
+  args.RequireNonFlags(2);
+
+  char program[] = "program";
+  char port[] = "--port=8080";
+  char verbose_include[] = "-vI";
+  char first_include[] = "/usr/include";
+  char second_include[] = "-I/opt/include";
+  char input[] = "input.txt";
+  char output[] = "output.txt";
+  char* argv[] = { program, port, verbose_include, first_include, second_include, input, output };
+
+  for (int i = 0; i < 3; ++i) {
+    g_allocations = 0;
+    g_count_allocations = true;
+    args.Reset();
+    args.Initialize(7, argv);
+    const bool parsed = args.GetResult().GetErrorCode() == ErrorCode::kNone;
+    const uint16_t port_value = args.GetAsUInt16("--port");
+    const StringView port_view = args.GetAsStringView("-p");
+    const bool verbose = args.Has("--verbose") && !args.Has("--help");
+    const ArrayView<StringView> includes = args.GetAll(include);
+    const size_t nonflags = args.GetNonFlagCount();
+    const StringView last = args.GetNonFlagViews()[1];
+    int64_t threads_value = 0;
+    const bool has_threads = args.GetAsInt64("--threads", threads_value);
+    g_count_allocations = false;
+
+    Assert(g_allocations == 0);
+    Assert(parsed);
+    Assert(port_value == 8080);
+    Assert(port_view == "8080");
+    Assert(verbose);
+    Assert(includes.size() == 2 && includes[0] == "/usr/include" && includes[1] == "/opt/include");
+    Assert(nonflags == 2 && last == "output.txt");
+    Assert(has_threads && threads_value == 4 && *threads == 4);
+  }
+
+  // Values are views into argv, whatever was asked for
+  Assert(args.GetValue(include).data() == second_include + 2);
+
+  cout << "pass" << endl;
+}
+
+void TestErrorCodes() {
+  cout << "TestErrorCodes()...";
+
+  Args args;
+  args.DisableExit();
+  args.DisableUsage();
+  args.AddRequiredFlagValue("--port", "-p", "Port to listen on");
+  args.AddOptionalFlagValue("--name", "-n", "Name");
+
+  char program[] = "program";
+  char name[] = "--name";
+  char value[] = "sargs";
+  char large[] = "--port=70000";
+  char* argv[] = { program, name, value, large };
+
+  g_allocations = 0;
+  g_count_allocations = true;
+  args.Initialize(3, argv);
+  const ErrorCode missing = args.GetResult().GetErrorCode();
+  const StringView subject = args.GetResult().GetErrorSubject();
+  g_count_allocations = false;
+  Assert(g_allocations == 0);
+  Assert(missing == ErrorCode::kMissingFlag);
+  Assert(subject == "--port");
+  Assert(args.GetResult().GetError() == "Must specify --port");
+
+  args.Reset();
+  args.Initialize(2, argv);
+  Assert(args.GetResult().GetErrorCode() == ErrorCode::kMissingValue);
+  Assert(args.GetResult().GetError() == "Must set value for --name");
+
+  // Exceptions are off, so a value out of range reads as zero
+  args.Reset();
+  args.Initialize(4, argv);
+  Assert(args.GetResult().GetErrorCode() == ErrorCode::kNone);
+  Assert(args.GetAsUInt16("--port") == 0);
+  Assert(args.GetAsUInt32("--port") == 70000);
+
+  char* many[SARGS_MAX_ARGS + 1];
+  for (char*& arg : many)
+    arg = value;
+  many[0] = program;
+  args.Reset();
+  args.Initialize(SARGS_MAX_ARGS + 1, many);
+  Assert(args.GetResult().GetErrorCode() == ErrorCode::kTooManyArguments);
+
+  cout << "pass" << endl;
+}
+
+// Keeps what is written to it in a fixed buffer, so capturing the usage does not allocate either
+class FixedBuffer : public std::streambuf {
+ public:
+  FixedBuffer() {
+    setp(_text, _text + sizeof(_text) - 1);
+  }
+
+  const char* c_str() {
+    *pptr() = '\0';
+    return _text;
+  }
+
+ private:
+  char _text[2048];
+};
+
+void TestUsageOnError() {
+  cout << "TestUsageOnError()...";
+
+  Args args;
+  args.DisableExit();
+  args.AddRequiredFlagValue("--port", "-p", "Port to listen on");
+  args.AddOptionalFlagValue("--name", "-n", "Name");
+  args.RequireNonFlags(1);
+
+  char program[] = "program";
+  char name[] = "--name=sargs";
+  char input[] = "input.txt";
+  char* argv[] = { program, name, input };
+
+  FixedBuffer buffer;
+  std::streambuf* const stdout_buffer = cout.rdbuf(&buffer);
+  g_allocations = 0;
+  g_count_allocations = true;
+  args.Initialize(3, argv);
+  g_count_allocations = false;
+  cout.rdbuf(stdout_buffer);
+
+  Assert(g_allocations == 0);
+  Assert(args.GetResult().GetErrorCode() == ErrorCode::kMissingFlag);
+  const std::string output = buffer.c_str();
+  Assert(output.find("Usage: program") == 0);
+  Assert(output.find("--port=value/-p=value") != std::string::npos);
+  Assert(output.find("\nError: Must specify --port\n") != std::string::npos);
+
+  cout << "pass" << endl;
+}
+
+void TestLimits() {
+  cout << "TestLimits()...";
+
+  char program[] = "program";
+  char* argv[] = { program };
+
+  // --help takes the last slot, so registering it fails
+  Args full;
+  full.DisableExit();
+  full.DisableUsage();
+  const char* names[] = { "-a", "-b", "-c", "-d", "-e", "-f", "-g", "-i" };
+  for (const char* flag : names)
+    Assert(full.AddOptionalFlag(flag, "", "A flag") != kUnknownFlag);
+  full.Initialize(1, argv);
+  Assert(full.GetResult().GetErrorCode() == ErrorCode::kTooManyFlags);
+  Assert(full.GetSchema().GetFlagCount() == SARGS_MAX_FLAGS);
+
+  Args wordy;
+  wordy.DisableExit();
+  wordy.DisableUsage();
+  const std::string description(SARGS_MAX_STRING_BYTES * 2, 'x');
+  wordy.AddOptionalFlag("--wordy", "-w", description);
+  wordy.Initialize(1, argv);
+  Assert(wordy.GetResult().GetErrorCode() == ErrorCode::kOutOfSpace);
+  Assert(wordy.GetResult().GetError() == "Out of space for flag names and descriptions");
+
+  cout << "pass" << endl;
+}
+
+int main(int, char* []) {
+try {
+  TestNoAllocations();
+  TestErrorCodes();
+  TestUsageOnError();
+  TestLimits();
+} catch (std::exception& ex) {
+  cerr << "\nFAIL\n" << endl;
+  return 1;
+}
+  printf("\nTests complete\n");
+  return 0;
+}
@@ -1,5 +1,14 @@
+// Statistics are compiled in here so TestStats() can check them; the examples build without them
+#define SARGS_ENABLE_STATS
 #include "sargs.h"
+#include "allocation_counter.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
 #include <stdexcept>
+#include <thread>
 
 using namespace sargs;
 using namespace std;
@@ -11,6 +20,24 @@ static inline bool AssertFailed(const std::string& message) {
 
 #define Assert(x) ((x) || (AssertFailed(#x)))
 
+#define TEST_STATIC_FLAGS(X) \
+  X(int64_t, threads, "--threads", "-t", "Worker threads") \
+  X(uint16_t, port, "--port", "", "Port to listen on") \
+  X(bool, verbose, "--verbose", "-v", "Verbose output") \
+  X(std::string, output, "--output", "-o", "Output path") \
+  X(sargs::StringView, mode, "--mode", "-m", "Mode") \
+  X(double, ratio, "--ratio", "", "Ratio")
+
+SARGS_STATIC_SCHEMA(StaticOptions, TEST_STATIC_FLAGS);
+
+// More than one flag with only an alias must still give unique case labels
+#define TEST_STATIC_ALIAS_FLAGS(X) \
+  X(int64_t, level, "", "-l", "Level") \
+  X(bool, quiet, "", "-q", "Quiet") \
+  X(bool, force, "--force", "", "Force")
+
+SARGS_STATIC_SCHEMA(StaticAliasOptions, TEST_STATIC_ALIAS_FLAGS);
+
 void TestUnsigned() {
   cout << "TestUnsigned()...";
 
@@ -295,6 +322,1078 @@ void TestBothFlagsAvailable() {
   cout << "pass" << endl;
 }
 
+void TestLargeRegistry() {
+  cout << "TestLargeRegistry()...";
+
+  Args args;
+  for (int i = 0; i < 500; ++i) {
+    const string id = to_string(i);
+    if (i % 2 == 0)
+      args.AddOptionalFlagValue("--value" + id, "-v" + id, "Value flag " + id);
+    else
+      args.AddOptionalFlag("--flag" + id, "-f" + id, "Flag " + id);
+  }
+
+  string str1 = "program";
+  string str2 = "-v498=last";
+  string str3 = "--flag1";
+  string str4 = "--value0";
+  string str5 = "first";
+  string str6 = "-f499";
+  char* argv[6] = { &str1.front(), &str2.front(), &str3.front(), &str4.front(), &str5.front(), &str6.front() };
+  args.Initialize(6, argv);
+
+  Assert(args.GetAsString("--value498") == "last");
+  Assert(args.GetAsString("-v0") == "first");
+  Assert(args.Has("-f1"));
+  Assert(args.Has("--flag499"));
+  Assert(!args.Has("--flag3"));
+  Assert(args.FindAlternative("-v10") == "--value10");
+  Assert(args.GetNonFlags().empty());
+
+  cout << "pass" << endl;
+}
+
+void TestTypedFlags() {
+  cout << "TestTypedFlags()...";
+
+  Args args;
+  Flag<uint32_t> batch = args.AddRequiredFlagValue("--batch", "-b", "Batch size");
+  Flag<float> ratio = args.AddOptionalFlagValue("--ratio", "", "Ratio", "0.5");
+  Flag<string> name = args.AddOptionalFlagValue("--name", "-n", "Name");
+  Flag<int16_t> level = args.AddOptionalFlagValue("", "-l", "Level");
+
+  string str1 = "program";
+  string str2 = "-b=4096";
+  string str3 = "-l";
+  string str4 = "-12";
+  char* argv[4] = { &str1.front(), &str2.front(), &str3.front(), &str4.front() };
+  args.Initialize(4, argv);
+
+  Assert(batch.Has());
+  Assert(batch.Get() == 4096);
+  Assert(ratio.Has());
+  Assert(*ratio == 0.5f);
+  Assert(!name.Has());
+  Assert(name.Get().empty());
+  Assert(*level == -12);
+
+  Args narrow;
+  Flag<uint8_t> small = narrow.AddOptionalFlagValue("--small", "", "Small");
+  string str5 = "--small=300";
+  char* argv_narrow[2] = { &str1.front(), &str5.front() };
+  try {
+    narrow.Initialize(2, argv_narrow);
+    cerr << "fail" << endl;
+    throw std::runtime_error("TestTypedFlags() failed");
+  } catch (SargsError& ex) {
+    Assert(string(ex.what()) == "Could not convert 300 for --small");
+  }
+  Assert(!small.Has());
+
+  Flag<int32_t> unregistered;
+  Assert(!unregistered.Has());
+
+  cout << "pass" << endl;
+}
+
+void TestArgvViews() {
+  cout << "TestArgvViews()...";
+
+  string str1 = "program";
+  string str2 = "--input=data.bin";
+  string str3 = "-o";
+  string str4 = "out.bin";
+  string str5 = "path/one";
+  string str6 = "path/two";
+  char* argv[6] = { &str1.front(), &str2.front(), &str3.front(), &str4.front(), &str5.front(), &str6.front() };
+
+  Args args;
+  args.AddRequiredFlagValue("--input", "-i", "Input");
+  args.AddOptionalFlagValue("--output", "-o", "Output");
+  args.AddOptionalFlagValue("--mode", "-m", "Mode", "fast");
+  args.RequireNonFlags(2);
+  args.EnableArgvViews();
+  args.Initialize(6, argv);
+
+  StringView input = args.GetAsStringView("-i");
+  Assert(input == "data.bin");
+  Assert(input.data() == argv[1] + 8);
+  Assert(args.GetAsStringView("--output").data() == argv[3]);
+  Assert(args.GetAsString("-m") == "fast");
+
+  const NonFlagList& nonflags = args.GetNonFlagViews();
+  Assert(nonflags.size() == 2);
+  Assert(nonflags[0].data() == argv[4]);
+  Assert(nonflags[1] == "path/two");
+  Assert(args.GetNonFlags()[1] == "path/two");
+
+  Args copying;
+  copying.AddRequiredFlagValue("--input", "-i", "Input");
+  copying.AddOptionalFlagValue("--output", "-o", "Output");
+  copying.RequireNonFlags(2);
+  copying.Initialize(6, argv);
+  str4[0] = 'X';
+  Assert(copying.GetAsString("--output") == "out.bin");
+  Assert(copying.GetNonFlag(0) == "path/one");
+
+  cout << "pass" << endl;
+}
+
+void TestSchemaParallelParse() {
+  cout << "TestSchemaParallelParse()...";
+
+  Schema schema;
+  schema.AddRequiredFlagValue("--id", "-i", "Request id");
+  schema.AddOptionalFlag("--verbose", "-v", "Verbose");
+  schema.AddOptionalFlagValue("--mode", "-m", "Mode", "fast");
+  schema.RequireNonFlags(1);
+  schema.Compile();
+
+  const int kThreads = 8;
+  const int kIterations = 500;
+  vector<int> failures(kThreads, 0);
+  vector<thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&schema, &failures, t]() {
+      for (int i = 0; i < kIterations; ++i) {
+        string str1 = "command";
+        string str2 = "--id=" + to_string(t * kIterations + i);
+        string str3 = (i % 2) ? "-v" : "--";
+        string str4 = "target" + to_string(t);
+        char* argv[4] = { &str1.front(), &str2.front(), &str3.front(), &str4.front() };
+
+        ParseResult result = schema.Parse(4, argv);
+        const bool ok = result.GetError().empty() &&
+                        result.GetAsInt64("-i") == t * kIterations + i &&
+                        result.Has("--verbose") == ((i % 2) == 1) &&
+                        result.GetAsString("--mode") == "fast" &&
+                        result.GetNonFlag(0) == str4;
+        if (!ok)
+          ++failures[t];
+      }
+    });
+  }
+  for (auto& worker : threads)
+    worker.join();
+
+  for (int t = 0; t < kThreads; ++t)
+    Assert(failures[t] == 0);
+
+  string str1 = "command";
+  char* argv[1] = { &str1.front() };
+  Assert(schema.Parse(1, argv).GetError() == "Unknown arguments or user must specify 1 non-flags");
+
+  cout << "pass" << endl;
+}
+
+void TestReparseAllocations() {
+  cout << "TestReparseAllocations()...";
+
+  Args args;
+  args.AddRequiredFlagValue("--input", "-i", "Input");
+  args.AddOptionalFlagValue("--mode", "-m", "Mode", "a fallback that is too long for any small string buffer");
+  args.AddOptionalFlag("--verbose", "-v", "Verbose");
+  Flag<uint32_t> count = args.AddOptionalFlagValue("--count", "-c", "Count");
+  args.RequireNonFlags(2);
+
+  string str1 = "program";
+  string str2 = "--input=/a/path/that/is/too/long/for/any/small/string/buffer";
+  string str3 = "-v";
+  string str4 = "-c";
+  string str5 = "12";
+  string str6 = "/the/first/non/flag/which/is/also/quite/long";
+  string str7 = "/the/second/non/flag/which/is/also/quite/long";
+  char* argv[7] = { &str1.front(), &str2.front(), &str3.front(), &str4.front(), &str5.front(),
+                    &str6.front(), &str7.front() };
+  args.Initialize(7, argv);
+  const string usage = args.GetFlagDescription();
+  Assert(*count == 12);
+
+  for (int i = 0; i < 3; ++i) {
+    str5 = (i % 2) ? "14" : "13";
+    args.Reset();
+    Assert(!args.Has("-v"));
+
+    g_allocations = 0;
+    g_count_allocations = true;
+    args.Initialize(7, argv);
+    g_count_allocations = false;
+
+    Assert(g_allocations == 0);
+    Assert(args.GetAsString("-i") == str2.substr(8));
+    Assert(args.Has("--verbose"));
+    Assert(args.GetNonFlag(1) == str7);
+    Assert(args.GetAsString("--mode") == "a fallback that is too long for any small string buffer");
+    Assert(*count == static_cast<uint32_t>(13 + i % 2));
+  }
+
+  Assert(args.GetFlagDescription() == usage);
+  Assert(args.GetSchema().GetFlagCount() == 5);
+
+  cout << "pass" << endl;
+}
+
+void TestHasAcrossWords() {
+  cout << "TestHasAcrossWords()...";
+
+  Args args;
+  for (int i = 0; i < 130; ++i)
+    args.AddOptionalFlag("--flag" + to_string(i), "-f" + to_string(i), "");
+
+  string str1 = "program";
+  string str2 = "--flag63";
+  string str3 = "-f64";
+  string str4 = "--flag129";
+  char* argv[4] = { &str1.front(), &str2.front(), &str3.front(), &str4.front() };
+  args.Initialize(4, argv);
+
+  g_allocations = 0;
+  g_count_allocations = true;
+  const bool has_63 = args.Has("-f63");
+  const bool has_64 = args.Has("--flag64");
+  const bool has_65 = args.Has("--flag65");
+  const bool has_129 = args.Has("-f129");
+  const bool has_unknown = args.Has("--unknown");
+  g_count_allocations = false;
+
+  Assert(has_63 && has_64 && has_129);
+  Assert(!has_65 && !has_unknown);
+  Assert(!args.Has("--flag0"));
+  Assert(g_allocations == 0);
+
+  cout << "pass" << endl;
+}
+
+void TestFlagIds() {
+  cout << "TestFlagIds()...";
+
+  Args args;
+  const FlagId verbose = args.AddOptionalFlag("--verbose", "-v", "Verbose");
+  const FlagId count = args.AddRequiredFlagValue("--count", "-c", "Count");
+  const FlagId name = args.AddOptionalFlagValue("--name", "", "Name", "none");
+  Assert(verbose == 0 && count == 1 && name == 2);
+
+  string str1 = "program";
+  string str2 = "-c=3";
+  string str3 = "--count";
+  string str4 = "4";
+  char* argv[4] = { &str1.front(), &str2.front(), &str3.front(), &str4.front() };
+  args.Initialize(4, argv);
+
+  Assert(args.FindId("--count") == count);
+  Assert(args.FindId("-c") == count);
+  Assert(args.FindId("--unknown") == kUnknownFlag);
+  Assert(args.FindId("") == kUnknownFlag);
+  Assert(args.Has(count));
+  Assert(!args.Has(verbose));
+  Assert(args.GetValue(count) == "4");
+  Assert(args.GetAsString("-c") == "4");
+  Assert(args.GetValue(name) == "none");
+  Assert(args.GetSchema().GetFlagCount() == 4);
+
+  cout << "pass" << endl;
+}
+
+void TestStaticSchema() {
+  cout << "TestStaticSchema()...";
+
+  string str1 = "program";
+  string str2 = "-t=12";
+  string str3 = "--output";
+  string str4 = "out.bin";
+  string str5 = "-v";
+  string str6 = "--ratio=0.25";
+  string str7 = "input.bin";
+  string str8 = "--port=70000";
+  char* argv[8] = { &str1.front(), &str2.front(), &str3.front(), &str4.front(), &str5.front(),
+                    &str6.front(), &str7.front(), &str8.front() };
+
+  StaticOptions options;
+  options.mode = "fast";
+  Assert(StaticOptions::kFlagCount == 6);
+  Assert(options.Parse(7, argv).empty());
+  Assert(options.threads == 12);
+  Assert(options.output == "out.bin");
+  Assert(options.verbose);
+  Assert(options.ratio == 0.25);
+  Assert(options.mode == "fast");
+  Assert(options.Has(StaticOptions::threads_flag));
+  Assert(!options.Has(StaticOptions::mode_flag));
+  Assert(options.nonflags.size() == 1 && options.nonflags[0] == "input.bin");
+
+  StaticOptions overflow;
+  Assert(overflow.Parse(8, argv) == "Could not convert 70000 for --port");
+
+  string str9 = "--";
+  string str10 = "-t";
+  char* argv_delim[4] = { &str1.front(), &str5.front(), &str9.front(), &str10.front() };
+  StaticOptions delim;
+  Assert(delim.Parse(4, argv_delim).empty());
+  Assert(delim.verbose && !delim.Has(StaticOptions::threads_flag));
+  Assert(delim.nonflags.size() == 1 && delim.nonflags[0] == "-t");
+
+  char* argv_missing[2] = { &str1.front(), &str10.front() };
+  StaticOptions missing;
+  Assert(missing.Parse(2, argv_missing) == "Must set value for -t");
+
+  string str12 = "-l=3";
+  string str13 = "-q";
+  char* argv_alias[3] = { &str1.front(), &str12.front(), &str13.front() };
+  StaticAliasOptions aliases;
+  Assert(aliases.Parse(3, argv_alias).empty());
+  Assert(aliases.level == 3 && aliases.quiet && !aliases.force);
+  Assert(aliases.nonflags.empty());
+
+  // Unlike the dynamic schema, one character names run together are not split
+  string str11 = "-vt4";
+  char* argv_group[2] = { &str1.front(), &str11.front() };
+  StaticOptions grouped;
+  Assert(grouped.Parse(2, argv_group).empty());
+  Assert(!grouped.verbose && !grouped.Has(StaticOptions::threads_flag));
+  Assert(grouped.nonflags.size() == 1 && grouped.nonflags[0] == "-vt4");
+
+  cout << "pass" << endl;
+}
+
+void TestBind() {
+  cout << "TestBind()...";
+
+  struct Config {
+    int threads = 1;
+    uint64_t limit = 10;
+    float scale = 1.0f;
+    string name = "default";
+    bool verbose = false;
+  } config;
+
+  Args args;
+  args.Bind("--threads", "-t", &config.threads, "Worker threads");
+  args.Bind("--limit", "", &config.limit, "Limit");
+  args.Bind("--scale", "-s", &config.scale, "Scale");
+  args.Bind("--name", "-n", &config.name, "Name");
+  const FlagId verbose = args.Bind("--verbose", "-v", &config.verbose, "Verbose");
+
+  string str1 = "program";
+  string str2 = "-t=8";
+  string str3 = "--name";
+  string str4 = "worker";
+  string str5 = "-v";
+  char* argv[5] = { &str1.front(), &str2.front(), &str3.front(), &str4.front(), &str5.front() };
+  args.Initialize(5, argv);
+
+  Assert(config.threads == 8);
+  Assert(config.limit == 10);
+  Assert(config.scale == 1.0f);
+  Assert(config.name == "worker");
+  Assert(config.verbose);
+  Assert(args.Has(verbose));
+
+  Args bad;
+  int value = 3;
+  bad.Bind("--value", "", &value, "Value");
+  string str6 = "--value=12abc";
+  char* argv_bad[2] = { &str1.front(), &str6.front() };
+  try {
+    bad.Initialize(2, argv_bad);
+    cerr << "fail" << endl;
+    throw std::runtime_error("TestBind() failed");
+  } catch (SargsError& ex) {}
+  Assert(value == 3);
+
+  cout << "pass" << endl;
+}
+
+void TestConversions() {
+  cout << "TestConversions()...";
+
+  int64_t int64_value = 0;
+  Assert(ConvertNumber("0x1F", 4, int64_value) && int64_value == 31);
+  Assert(ConvertNumber("017", 3, int64_value) && int64_value == 15);
+  Assert(ConvertNumber("0b101", 5, int64_value) && int64_value == 5);
+  Assert(ConvertNumber("-9223372036854775808", 20, int64_value) &&
+         int64_value == std::numeric_limits<int64_t>::min());
+  Assert(ConvertNumber("9223372036854775807", 19, int64_value) &&
+         int64_value == std::numeric_limits<int64_t>::max());
+  Assert(!ConvertNumber("9223372036854775808", 19, int64_value));
+  Assert(!ConvertNumber("12abc", 5, int64_value));
+  Assert(!ConvertNumber("", 0, int64_value));
+  Assert(int64_value == std::numeric_limits<int64_t>::max());
+
+  uint64_t uint64_value = 0;
+  Assert(ConvertNumber("18446744073709551615", 20, uint64_value) &&
+         uint64_value == std::numeric_limits<uint64_t>::max());
+  Assert(!ConvertNumber("18446744073709551616", 20, uint64_value));
+  Assert(!ConvertNumber("-1", 2, uint64_value));
+
+  int8_t int8_value = 0;
+  Assert(ConvertNumber("-128", 4, int8_value) && int8_value == -128);
+  Assert(!ConvertNumber("128", 3, int8_value));
+
+  double double_value = 0.0;
+  Assert(ConvertNumber("0.1", 3, double_value) && double_value == 0.1);
+  Assert(ConvertNumber("-2.5e-3", 7, double_value) && double_value == -2.5e-3);
+  Assert(ConvertNumber("1e308", 5, double_value) && double_value == 1e308);
+  Assert(ConvertNumber("3.141592653589793238462643383279", 32, double_value) &&
+         double_value == 3.141592653589793);
+  Assert(!ConvertNumber("1e400", 5, double_value));
+  Assert(!ConvertNumber("1.5f", 4, double_value));
+
+  float float_value = 0.0f;
+  Assert(ConvertNumber("0.1", 3, float_value) && float_value == 0.1f);
+  Assert(ConvertNumber("16777217", 8, float_value) && float_value == 16777216.0f);
+
+  // A stale errno from an earlier call must not fail a valid value
+  Args args;
+  args.AddRequiredFlagValue("--value", "", "Value");
+  string str1 = "program";
+  string str2 = "--value=0x10";
+  char* argv[2] = { &str1.front(), &str2.front() };
+  args.Initialize(2, argv);
+  errno = ERANGE;
+  Assert(args.GetAsInt64("--value") == 16);
+  Assert(args.GetAsUInt8("--value") == 16);
+  try {
+    args.GetAsFloat("--value");
+    cerr << "fail" << endl;
+    throw std::runtime_error("TestConversions() failed");
+  } catch (SargsError& ex) {}
+
+  // Doubles keep every digit a float would lose
+  Args doubles;
+  doubles.AddRequiredFlagValue("--pi", "-p", "Pi");
+  Flag<double> tenth = doubles.AddOptionalFlagValue("--tenth", "", "A tenth", "0.1");
+  string str3 = "-p=3.141592653589793";
+  char* argv_doubles[2] = { &str1.front(), &str3.front() };
+  doubles.Initialize(2, argv_doubles);
+  Assert(doubles.GetAsDouble("--pi") == 3.141592653589793);
+  Assert(static_cast<double>(doubles.GetAsFloat("--pi")) != 3.141592653589793);
+  Assert(*tenth == 0.1);
+  double pi = 0.0;
+  Assert(doubles.GetAsDouble("-p", pi) && pi == 3.141592653589793);
+
+  cout << "pass" << endl;
+}
+
+static void WriteFile(const char* path, const string& contents) {
+  FILE* file = fopen(path, "wb");
+  fwrite(contents.data(), 1, contents.size(), file);
+  fclose(file);
+}
+
+void TestResponseFiles() {
+  cout << "TestResponseFiles()...";
+
+  WriteFile("sargs_paths.rsp", string("path one\0path two\0", 18));
+  WriteFile("sargs_flags.rsp", "--input=data.bin\n-o out.bin  \t@sargs_paths.rsp\n-- @literal");
+  // Exactly one page with no trailing delimiter, so the last token ends at the end of the mapping
+  WriteFile("sargs_page.rsp", "-o " + string(4093, 'x'));
+  WriteFile("sargs_quoted.rsp", "-o \"my dir/out.bin\" 'it''s' \"\" a\\ b\\\\ \"say \\\"hi\\\"\"\nc");
+
+  string str1 = "program";
+  string str2 = "@sargs_flags.rsp";
+  char* argv[2] = { &str1.front(), &str2.front() };
+
+  Args args;
+  args.AddRequiredFlagValue("--input", "-i", "Input");
+  args.AddOptionalFlagValue("--output", "-o", "Output");
+  args.RequireNonFlags(3);
+  args.EnableArgvViews();
+  args.EnableResponseFiles();
+  args.Initialize(2, argv);
+  Assert(args.GetAsString("--input") == "data.bin");
+  Assert(args.GetAsStringView("-o") == "out.bin");
+  Assert(args.GetAsStringView("-o").data()[7] == '\0');
+  const NonFlagList& nonflags = args.GetNonFlagViews();
+  Assert(nonflags.size() == 3);
+  Assert(nonflags[0] == "path one");
+  Assert(nonflags[1] == "path two");
+  Assert(nonflags[2] == "@literal");
+
+  Args page;
+  page.AddOptionalFlagValue("--output", "-o", "Output");
+  page.EnableResponseFiles();
+  string str3 = "@sargs_page.rsp";
+  char* argv_page[2] = { &str1.front(), &str3.front() };
+  page.Initialize(2, argv_page);
+  Assert(page.GetAsString("-o") == string(4093, 'x'));
+
+  Args quoted;
+  quoted.AddOptionalFlagValue("--output", "-o", "Output");
+  quoted.RequireNonFlags(5);
+  quoted.EnableResponseFiles();
+  string str5 = "@sargs_quoted.rsp";
+  char* argv_quoted[2] = { &str1.front(), &str5.front() };
+  quoted.Initialize(2, argv_quoted);
+  Assert(quoted.GetAsString("-o") == "my dir/out.bin");
+  const vector<string> words = quoted.GetNonFlags();
+  Assert(words.size() == 5);
+  Assert(words[0] == "its");
+  Assert(words[1].empty());
+  Assert(words[2] == "a b\\");
+  Assert(words[3] == "say \"hi\"");
+  Assert(words[4] == "c");
+
+  Args missing;
+  missing.DisableExit();
+  missing.DisableUsage();
+  missing.EnableResponseFiles();
+  string str4 = "@sargs_missing.rsp";
+  char* argv_missing[2] = { &str1.front(), &str4.front() };
+  missing.Initialize(2, argv_missing);
+  Assert(missing.GetResult().GetError() == "Could not read response file sargs_missing.rsp");
+
+  remove("sargs_paths.rsp");
+  remove("sargs_flags.rsp");
+  remove("sargs_page.rsp");
+  remove("sargs_quoted.rsp");
+
+  cout << "pass" << endl;
+}
+
+void TestNonFlagHandler() {
+  cout << "TestNonFlagHandler()...";
+
+  vector<string> storage = { "program", "a.txt", "--output", "out.bin", "b.txt", "--", "--c.txt" };
+  vector<char*> argv;
+  for (string& arg : storage)
+    argv.push_back(&arg.front());
+
+  vector<string> seen;
+  Args args;
+  args.AddOptionalFlagValue("--output", "-o", "Output");
+  args.SetNonFlagHandler([&](const StringView& nonflag) { seen.push_back(nonflag); });
+  args.Initialize(static_cast<int>(argv.size()), argv.data());
+  Assert(seen.size() == 3);
+  Assert(seen[0] == "a.txt");
+  Assert(seen[1] == "b.txt");
+  Assert(seen[2] == "--c.txt");
+  Assert(args.GetNonFlagCount() == 3);
+  Assert(args.GetNonFlagViews().empty());
+  Assert(args.GetAsString("-o") == "out.bin");
+
+  size_t count = 0;
+  Args required;
+  required.DisableExit();
+  required.DisableUsage();
+  required.AddOptionalFlagValue("--output", "-o", "Output");
+  required.RequireNonFlags(2);
+  required.SetNonFlagHandler([&](const StringView&) { ++count; });
+  required.Initialize(static_cast<int>(argv.size()), argv.data());
+  Assert(count == 3);
+  Assert(!required.GetResult().GetError().empty());
+
+  cout << "pass" << endl;
+}
+
+void TestRepeatedFlags() {
+  cout << "TestRepeatedFlags()...";
+
+  vector<string> storage = { "program", "--include", "a", "-n=1", "-I=b", "--name", "x", "--include=c", "-n", "0x10",
+                             "path" };
+  vector<char*> argv;
+  for (string& arg : storage)
+    argv.push_back(&arg.front());
+
+  Args args;
+  const FlagId include = args.AddOptionalRepeatedFlagValue("--include", "-I", "Include directory");
+  args.AddRequiredRepeatedFlagValue("--number", "-n", "Number");
+  args.AddOptionalFlagValue("--name", "", "Name");
+  args.AddOptionalRepeatedFlagValue("--unused", "", "Unused");
+  args.RequireNonFlags(1);
+  args.ReserveRepeatedValues(8);
+  args.Initialize(static_cast<int>(argv.size()), argv.data());
+
+  const ArrayView<StringView> includes = args.GetAll(include);
+  Assert(includes.size() == 3);
+  Assert(includes[0] == "a");
+  Assert(includes[1] == "b");
+  Assert(includes[2] == "c");
+  Assert(includes.data() + 3 == args.GetAll("-I").end());
+  Assert(args.GetAsString("--include") == "c");
+
+  const vector<int64_t> numbers = args.GetAllAsInt64("--number");
+  Assert(numbers.size() == 2);
+  Assert(numbers[0] == 1 && numbers[1] == 16);
+  Assert(args.GetAll("--name").size() == 1);
+  Assert(args.GetAll("--unused").empty());
+  Assert(args.GetNonFlag(0) == "path");
+
+  vector<int64_t> values;
+  try {
+    args.GetAllAsInt64("--include", values);
+    cerr << "fail" << endl;
+    throw std::runtime_error("TestRepeatedFlags() failed");
+  } catch (SargsError& ex) {}
+  Assert(values.empty());
+
+  cout << "pass" << endl;
+}
+
+void TestLists() {
+  cout << "TestLists()...";
+
+  vector<float> floats;
+  size_t offset = 0;
+  Assert(ConvertList("1.5,2,-3e2", 10, ',', floats, offset));
+  Assert(floats.size() == 3 && floats[0] == 1.5f && floats[1] == 2.0f && floats[2] == -300.0f);
+  Assert(!ConvertList("1,2,x,4", 7, ',', floats, offset) && offset == 4);
+  Assert(!ConvertList("1,2,", 4, ',', floats, offset) && offset == 4);
+  Assert(!ConvertList("1,,2", 4, ',', floats, offset) && offset == 2);
+  Assert(floats.empty());
+
+  string str1 = "program";
+  string str2 = "--ids=1,0x10,-3";
+  string str3 = "--weights=0.5:12abc";
+  char* argv[3] = { &str1.front(), &str2.front(), &str3.front() };
+  Args args;
+  args.AddOptionalFlagValue("--ids", "", "Ids");
+  args.AddOptionalFlagValue("--weights", "", "Weights");
+  args.AddOptionalFlagValue("--missing", "", "Missing");
+  args.Initialize(3, argv);
+
+  const vector<int64_t> ids = args.GetAsInt64List("--ids");
+  Assert(ids.size() == 3 && ids[0] == 1 && ids[1] == 16 && ids[2] == -3);
+  Assert(args.GetAsFloatList("--missing").empty());
+  try {
+    args.GetAsFloatList("--weights", floats, ':');
+    cerr << "fail" << endl;
+    throw std::runtime_error("TestLists() failed");
+  } catch (SargsError& ex) {
+    Assert(string(ex.what()) == "Could not convert \"12abc\" at offset 4 of --weights to float");
+  }
+
+  cout << "pass" << endl;
+}
+
+void TestBinaryFlags() {
+  cout << "TestBinaryFlags()...";
+
+  const uint64_t ids[3] = { 1, 0xFFFFFFFFFFFFFFFFull, 42 };
+  WriteFile("sargs_ids.u64", string(reinterpret_cast<const char*>(ids), sizeof(ids)));
+  WriteFile("sargs_odd.bin", string(12, '\0'));
+
+  string str1 = "program";
+  string str2 = "--ids=@sargs_ids.u64";
+  string str3 = "-o";
+  string str4 = "sargs_odd.bin";
+  char* argv[4] = { &str1.front(), &str2.front(), &str3.front(), &str4.front() };
+
+  Args args;
+  args.AddRequiredBinaryFlagValue("--ids", "", "Ids");
+  args.AddOptionalBinaryFlagValue("--odd", "-o", "Odd sized file");
+  args.AddOptionalFlagValue("--name", "", "Name");
+  args.Initialize(4, argv);
+
+  const ArrayView<uint64_t> values = args.GetAsArray<uint64_t>("--ids");
+  Assert(values.size() == 3);
+  Assert(values[0] == 1 && values[1] == 0xFFFFFFFFFFFFFFFFull && values[2] == 42);
+  Assert(args.GetAsArray<uint32_t>("--odd").size() == 3);
+  Assert(args.GetAsArray<uint32_t>("--name").empty());
+  try {
+    args.GetAsArray<uint64_t>("-o");
+    cerr << "fail" << endl;
+    throw std::runtime_error("TestBinaryFlags() failed");
+  } catch (SargsError& ex) {
+    Assert(string(ex.what()) == "Size of sargs_odd.bin is not a multiple of 8 bytes");
+  }
+
+  Args missing;
+  missing.DisableExit();
+  missing.DisableUsage();
+  missing.AddRequiredBinaryFlagValue("--ids", "", "Ids");
+  string str5 = "--ids=@sargs_missing.u64";
+  char* argv_missing[2] = { &str1.front(), &str5.front() };
+  missing.Initialize(2, argv_missing);
+  Assert(missing.GetResult().GetError() == "Could not map sargs_missing.u64 for --ids");
+
+  // With response files on, the @ of a binary flag's file still marks a file rather than a response file,
+  // whether the file is joined to the flag or follows it, including from inside a response file
+  WriteFile("sargs_binary.rsp", "--odd @sargs_odd.bin");
+  string str6 = "--ids";
+  string str7 = "@sargs_ids.u64";
+  string str8 = "@sargs_binary.rsp";
+  char* argv_split[4] = { &str1.front(), &str6.front(), &str7.front(), &str8.front() };
+  char* argv_joined[3] = { &str1.front(), &str2.front(), &str8.front() };
+  char** argvs[2] = { argv_split, argv_joined };
+  const int argcs[2] = { 4, 3 };
+  for (int i = 0; i < 2; ++i) {
+    Args expanded;
+    expanded.DisableExit();
+    expanded.DisableUsage();
+    expanded.EnableResponseFiles();
+    expanded.AddRequiredBinaryFlagValue("--ids", "", "Ids");
+    expanded.AddOptionalBinaryFlagValue("--odd", "-o", "Odd sized file");
+    expanded.Initialize(argcs[i], argvs[i]);
+    Assert(expanded.GetResult().GetError().empty());
+    Assert(expanded.GetAsArray<uint64_t>("--ids").size() == 3);
+    Assert(expanded.GetAsArray<uint32_t>("--odd").size() == 3);
+  }
+
+  remove("sargs_binary.rsp");
+  remove("sargs_ids.u64");
+  remove("sargs_odd.bin");
+
+  cout << "pass" << endl;
+}
+
+void TestLazyUsage() {
+  cout << "TestLazyUsage()...";
+
+  Args args;
+  args.DisableHelp();
+  args.SetDescWidth(20);
+  args.SetDescStartColumn(12);
+  args.AddOptionalFlagValue("--name", "-n", "A description long enough to be wrapped twice");
+  Assert(args.GetFlagDescription().empty());
+
+  string str1 = "program";
+  char* argv[1] = { &str1.front() };
+  args.Initialize(1, argv);
+  Assert(args.GetFlagDescription() ==
+         "\n  Optional flags:\n"
+         "    --name=value/-n=valueA description long \n"
+         "            enough to be \n"
+         "            wrapped twice\n");
+  Assert(args.GetPreamble() == "Usage: program [--name=value|-n=value] \n");
+
+  args.SetPreamble("Custom\n");
+  stringstream usage;
+  args.PrintUsage(usage);
+  Assert(usage.str() == "Custom\n" + args.GetFlagDescription());
+
+  cout << "pass" << endl;
+}
+
+void TestStats() {
+  cout << "TestStats()...";
+
+  Assert(ParseStats::kEnabled);
+  Args args;
+  args.DisableHelp();
+  args.AddOptionalFlagValue("--count", "-c", "Count", "3");
+  args.AddOptionalFlagValue("--ratio", "-r", "Ratio");
+  args.AddOptionalFlagValue("--list", "-l", "List");
+  args.RequireNonFlags(1);
+  string str1 = "program";
+  string str2 = "--ratio=0.5";
+  string str3 = "-l";
+  string str4 = "1,2,3";
+  string str5 = "file";
+  char* argv[5] = { &str1.front(), &str2.front(), &str3.front(), &str4.front(), &str5.front() };
+  args.Initialize(5, argv);
+
+  const ParseStats& stats = args.GetStats();
+  Assert(stats.tokens == 4);
+  // "file" cannot name a flag so it is not looked up
+  Assert(stats.lookups == 3);
+  Assert(stats.probes >= 2);
+  Assert(stats.storage_bytes >= str2.size() + str4.size() + str5.size());
+  Assert(stats.retained_bytes >= stats.storage_bytes);
+  Assert(stats.float_conversions == 0);
+
+  Assert(args.GetAsUInt32("--count") == 3);
+  Assert(args.GetAsFloat("--ratio") == 0.5f);
+  Assert(args.GetAsInt64List("--list").size() == 3);
+  Assert(args.GetAsString("--list") == "1,2,3");
+  Assert(stats.integer_conversions == 1);
+  Assert(stats.float_conversions == 1);
+  Assert(stats.list_conversions == 1);
+  Assert(stats.string_conversions == 1);
+  Assert(stats.lookups == 7);
+
+  args.GetFlagDescription();
+  stringstream output;
+  output << stats;
+  Assert(output.str().find("tokens 4\n") == 0);
+  size_t count = 0;
+  stats.ForEach([&](const char*, const uint64_t) { ++count; });
+  Assert(count == 15);
+
+  // Reparsing starts the statistics over and, with the memory already reserved, allocates nothing
+  args.Initialize(5, argv);
+  Assert(stats.tokens == 4);
+  Assert(stats.float_conversions == 0);
+  Assert(stats.allocations == 0);
+
+  cout << "pass" << endl;
+}
+
+void TestTracing() {
+  cout << "TestTracing()...";
+
+  {
+    Args args;
+    args.DisableHelp();
+    args.AddOptionalFlagValue("--name", "-n", "Name", "none");
+    args.RequireNonFlags(1);
+    args.EnableTracing("sargs_trace.json", true);
+    string str1 = "program";
+    string str2 = "--name=\"quoted\"";
+    string str3 = "file";
+    char* argv[3] = { &str1.front(), &str2.front(), &str3.front() };
+    args.Initialize(3, argv);
+    args.Reset();
+    args.Initialize(3, argv);
+    Assert(args.GetAsString("--name") == "\"quoted\"");
+  }
+
+  ifstream file("sargs_trace.json");
+  stringstream trace;
+  trace << file.rdbuf();
+  const string json = trace.str();
+  Assert(json.find("[\n  {\"name\": ") == 0);
+  Assert(json.size() > 3 && json.compare(json.size() - 3, 3, "\n]\n") == 0);
+  const char* phases[] = { "Initialize", "Compile", "Parse", "ReserveStorage", "ParseTokens", "CheckForValues",
+                           "CheckForMissing", "AddFallbackValues", "LoadSlots" };
+  for (const char* phase : phases)
+    Assert(json.find("{\"name\": \"" + string(phase) + "\", \"cat\": \"sargs\", \"ph\": \"X\"") != string::npos);
+  Assert(json.find("\"name\": \"--name=\\\"quoted\\\"\", \"cat\": \"sargs.token\"") != string::npos);
+  Assert(json.find("\"args\": {\"index\": 2}") != string::npos);
+  // Both parses were appended
+  Assert(json.find("\"Initialize\"") != json.rfind("\"Initialize\""));
+  remove("sargs_trace.json");
+
+  cout << "pass" << endl;
+}
+
+void TestShortFlags() {
+  cout << "TestShortFlags()...";
+
+  Args args;
+  args.DisableHelp();
+  args.AddOptionalFlag("-v", "--verbose", "Verbose");
+  args.AddOptionalFlag("--extract", "-x", "Extract");
+  args.AddOptionalFlagValue("-p", "--port", "Port");
+  args.AddOptionalFlagValue("-o", "--output", "Output");
+  args.RequireNonFlags(2);
+  string str1 = "program";
+  string str2 = "-vxp2";
+  string str3 = "-o";
+  string str4 = "out.bin";
+  string str5 = "-vz";
+  string str6 = "-5";
+  char* argv[6] = { &str1.front(), &str2.front(), &str3.front(), &str4.front(), &str5.front(), &str6.front() };
+  args.Initialize(6, argv);
+  Assert(args.Has("--verbose"));
+  Assert(args.Has("--extract"));
+  Assert(args.GetAsInt32("--port") == 2);
+  Assert(args.GetAsString("--output") == "out.bin");
+  // Groups with characters that are not flags stay non-flags
+  Assert(args.GetNonFlag(0) == "-vz");
+  Assert(args.GetNonFlag(1) == "-5");
+
+  // The value of the last flag in a group may follow an '=' or be the next argument
+  Args grouped;
+  grouped.DisableHelp();
+  grouped.DisableUsage();
+  grouped.DisableExit();
+  grouped.DisableExceptions();
+  grouped.AddOptionalFlag("-v", "", "Verbose");
+  grouped.AddOptionalFlagValue("-p", "", "Port");
+  grouped.AddOptionalFlagValue("--name", "-n", "Name");
+  grouped.EnableArgvViews();
+  string str7 = "-vp=80";
+  string str8 = "-vn";
+  string str9 = "value";
+  char* argv_grouped[4] = { &str1.front(), &str7.front(), &str8.front(), &str9.front() };
+  grouped.Initialize(4, argv_grouped);
+  Assert(grouped.GetResult().GetError().empty());
+  Assert(grouped.GetAsUInt32("-p") == 80);
+  Assert(grouped.GetAsString("--name") == "value");
+
+  grouped.Reset();
+  char* argv_missing[2] = { &str1.front(), &str8.front() };
+  grouped.Initialize(2, argv_missing);
+  Assert(grouped.GetResult().GetError() == "Must set value for -n");
+  Assert(grouped.GetResult().GetErrorCode() == ErrorCode::kMissingValue);
+
+  // Attached values are counted when storage is reserved for a non-flag handler
+  Schema schema;
+  schema.AddOptionalFlagValue("-p", "", "Port");
+  size_t count = 0;
+  schema.SetNonFlagHandler([&](const StringView&) { ++count; });
+  schema.Compile();
+  string str10 = "-p12345678901234567890";
+  char* argv_handler[3] = { &str1.front(), &str10.front(), &str9.front() };
+  ParseResult result = schema.Parse(3, argv_handler);
+  Assert(result.GetError().empty());
+  Assert(result.GetAsString("-p") == "12345678901234567890");
+  Assert(count == 1);
+
+  cout << "pass" << endl;
+}
+
+// Parses args on one thread and on several and checks the results are the same
+static bool ParsesAlike(Schema& schema, vector<string>& args, const bool views, const bool repeated) {
+  vector<char*> argv;
+  for (string& arg : args)
+    argv.push_back(&arg.front());
+  const int argc = static_cast<int>(argv.size());
+
+  // Require exactly the non-flags given so the results are compared rather than both failing
+  schema.RequireNonFlags(0);
+  schema.Compile();
+  schema.RequireNonFlags(static_cast<int>(schema.Parse(argc, argv.data()).GetNonFlagCount()));
+  ParseResult serial = schema.Parse(argc, argv.data());
+  schema.EnableParallelParse(4, 1);
+  ParseResult parallel = schema.Parse(argc, argv.data());
+  schema.EnableParallelParse(1);
+
+  if (serial.GetError() != parallel.GetError() || serial.GetNonFlagViews() != parallel.GetNonFlagViews())
+    return false;
+  if (!serial.GetError().empty())
+    return serial.GetError().find("Must set value") == 0;
+  for (const char* name : { "--bool", "--value", "-x", "-p" }) {
+    if (serial.Has(name) != parallel.Has(name))
+      return false;
+    if (serial.Has(name) && serial.GetAsString(name) != parallel.GetAsString(name))
+      return false;
+  }
+  if (repeated) {
+    const ArrayView<StringView> serial_values = serial.GetAll("--value");
+    const ArrayView<StringView> parallel_values = parallel.GetAll("--value");
+    if (!std::equal(serial_values.begin(), serial_values.end(), parallel_values.begin()) ||
+        serial_values.size() != parallel_values.size())
+      return false;
+  }
+  // Non-flags are copied unless views were asked for
+  for (size_t i = 0; i < parallel.GetNonFlagCount(); ++i) {
+    const char* data = parallel.GetNonFlagViews()[i].data();
+    const bool in_argv = std::find(argv.begin(), argv.end(), data) != argv.end();
+    if (in_argv != views)
+      return false;
+  }
+  return true;
+}
+
+void TestParallelParseMode() {
+  cout << "TestParallelParseMode()...";
+
+  const char* pieces[] = { "--bool", "--value", "--value=v", "-x", "-xp3", "-xp", "7", "file", "-5", "-q" };
+  const size_t piece_count = sizeof(pieces) / sizeof(pieces[0]);
+  for (int mode = 0; mode < 4; ++mode) {
+    const bool views = (mode & 1) != 0;
+    const bool repeated = (mode & 2) != 0;
+    for (unsigned seed = 1; seed <= 20; ++seed) {
+      Schema schema;
+      schema.AddOptionalFlag("--bool", "-b", "Bool");
+      if (repeated)
+        schema.AddOptionalRepeatedFlagValue("--value", "-v", "Value");
+      else
+        schema.AddOptionalFlagValue("--value", "-v", "Value");
+      schema.AddOptionalFlag("-x", "", "X");
+      schema.AddOptionalFlagValue("-p", "", "P");
+      schema.DisableExceptions();
+      if (views)
+        schema.EnableArgvViews();
+
+      // Without repeated flags the parse stops looking for flags once four have been seen
+      vector<string> args = { "program" };
+      unsigned state = seed;
+      for (int i = 0; i < 300; ++i) {
+        state = state * 1103515245 + 12345;
+        args.push_back((seed % 3 == 0 && i == 200) ? "--" : pieces[(state >> 16) % piece_count]);
+      }
+      Assert(ParsesAlike(schema, args, views, repeated));
+    }
+  }
+
+  cout << "pass" << endl;
+}
+
+void TestLeadingBytes() {
+  cout << "TestLeadingBytes()...";
+
+  // Names need not start with a dash
+  Args args;
+  args.DisableHelp();
+  args.AddOptionalFlag("verbose", "", "Verbose");
+  args.AddOptionalFlagValue("x", "", "X");
+  args.AddOptionalFlagValue("--level", "-l", "Level");
+  args.RequireNonFlags(3);
+  string str1 = "program";
+  string str2 = "verbose";
+  string str3 = "x=3";
+  string str4 = "path/to/file";
+  string str5 = "-5";
+  string str6 = "-l2";
+  string str7 = "vector";
+  char* argv[7] = { &str1.front(), &str2.front(), &str7.front(), &str3.front(), &str4.front(), &str5.front(),
+                    &str6.front() };
+  args.Initialize(7, argv);
+  // The path and -5 are ruled out from their first bytes; "vector" starts like "verbose"
+  Assert(args.GetStats().lookups == 5);
+  Assert(args.Has("verbose"));
+  Assert(args.GetAsInt32("x") == 3);
+  Assert(args.GetAsInt32("--level") == 2);
+  Assert(args.GetNonFlag(0) == "vector");
+  Assert(args.GetNonFlag(1) == "path/to/file");
+  Assert(args.GetNonFlag(2) == "-5");
+
+  cout << "pass" << endl;
+}
+
+void TestArena() {
+  cout << "TestArena()...";
+
+  // Names are built before counting, since passing them as literals makes temporary strings
+  const string input = "--input";
+  const string mode = "--mode";
+  const string verbose = "--verbose";
+  const string description = "A flag";
+  const string fallback = "a fallback that is too long for any small string buffer";
+  string str1 = "program";
+  string str2 = "--input=/a/path/that/is/too/long/for/any/small/string/buffer";
+  string str3 = "--verbose";
+  string str4 = "/the/first/non/flag/which/is/also/quite/long";
+  string str5 = "second";
+  string str6 = "third";
+  char* argv[6] = { &str1.front(), &str2.front(), &str3.front(), &str4.front(), &str5.front(), &str6.front() };
+
+  // Registering, compiling and parsing take nothing from the heap once the buffer is large enough
+  alignas(16) char buffer[8192];
+  Arena arena(buffer, sizeof(buffer));
+  {
+    g_allocations = 0;
+    g_count_allocations = true;
+    Schema schema(&arena);
+    schema.AddRequiredFlagValue(input, "", description);
+    schema.AddOptionalFlagValue(mode, "", description, fallback);
+    schema.AddOptionalFlag(verbose, "", description);
+    schema.RequireNonFlags(3);
+    schema.Compile();
+    ParseResult result(&arena);
+    schema.Parse(6, argv, result);
+    g_count_allocations = false;
+
+    Assert(g_allocations == 0);
+    Assert(arena.GetBlockCount() == 0);
+    Assert(arena.GetBytesUsed() > 0 && arena.GetBytesUsed() <= sizeof(buffer));
+    Assert(result.GetError().empty());
+    Assert(result.GetAsString("--input") == str2.substr(8));
+    Assert(result.GetAsString("--mode") == fallback);
+    Assert(result.Has("--verbose"));
+    Assert(result.GetNonFlag(0) == str4);
+    Assert(result.GetNonFlagViews().size() == 3 && result.GetNonFlag(2) == str6);
+    Assert(result.GetBinary() == "program");
+  }
+  arena.Release();
+  Assert(arena.GetBytesUsed() == 0);
+
+  // Past the buffer the arena takes a few growing blocks from the heap
+  Arena small(buffer, 64);
+  Args args(&small);
+  args.DisableHelp();
+  for (int i = 0; i < 200; ++i)
+    args.AddOptionalFlagValue("--flag" + to_string(i), "", "Flag " + to_string(i), to_string(i));
+  args.Initialize(1, argv);
+  Assert(args.GetAsInt32("--flag199") == 199);
+  Assert(small.GetBlockCount() > 0 && small.GetBlockCount() < 10);
+
+  cout << "pass" << endl;
+}
+
 int main(int, char* []) {
 try {
   TestValues();
@@ -307,6 +1406,28 @@ try {
   TestInt16DownconvertLimit();
   TestInt8DownconvertLimit();
   TestBothFlagsAvailable();
+  TestLargeRegistry();
+  TestTypedFlags();
+  TestArgvViews();
+  TestSchemaParallelParse();
+  TestReparseAllocations();
+  TestHasAcrossWords();
+  TestFlagIds();
+  TestStaticSchema();
+  TestBind();
+  TestConversions();
+  TestResponseFiles();
+  TestNonFlagHandler();
+  TestRepeatedFlags();
+  TestLists();
+  TestBinaryFlags();
+  TestLazyUsage();
+  TestStats();
+  TestTracing();
+  TestShortFlags();
+  TestParallelParseMode();
+  TestLeadingBytes();
+  TestArena();
 } catch (std::exception& ex) {
   cerr << "\nFAIL\n" << endl;
   return 1;